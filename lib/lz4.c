@@ -54,8 +54,8 @@
  * LZ4_ACCELERATION_MAX :
  * Any "acceleration" value higher than this threshold
  * get treated as LZ4_ACCELERATION_MAX instead (fix #876)
+ * Defined in lz4.h (static linking only section).
  */
-#define LZ4_ACCELERATION_MAX 65537
 
 
 /*-************************************
@@ -235,6 +235,35 @@ void  LZ4_free(void* p);
 #endif
 #define MEM_INIT(p,v,s)   LZ4_memset((p),(v),(s))
 
+/* States created with LZ4_CustomMem :
+ * @alignment and @cmem.numaNode are only forwarded to custom allocators.
+ * Default allocator provides malloc() alignment, which is enough for all states. */
+#define LZ4_STATE_ALIGNMENT 64   /* cache line : states placed side by side don't share lines */
+LZ4_FORCE_INLINE void* LZ4_customAlloc(size_t size, LZ4_CustomMem cmem)
+{
+    if (cmem.customAlloc != NULL)
+        return cmem.customAlloc(cmem.opaqueState, size, LZ4_STATE_ALIGNMENT, cmem.numaNode);
+#if defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION)
+    return NULL;
+#else
+    return ALLOC(size);
+#endif
+}
+
+LZ4_FORCE_INLINE void LZ4_customFree(void* p, size_t size, LZ4_CustomMem cmem)
+{
+    if (p == NULL) return;
+    if (cmem.customAlloc != NULL) {
+        if (cmem.customFree != NULL) cmem.customFree(cmem.opaqueState, p, size);
+        return;   /* no customFree : memory is reclaimed by owner, ex: LZ4_arenaAlloc() */
+    }
+#if !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION)
+    FREEMEM(p);
+#else
+    (void)size;
+#endif
+}
+
 
 /*-************************************
 *  Common Constants
@@ -437,17 +466,15 @@ static U16 LZ4_readLE16(const void* memPtr)
     }
 }
 
-#ifdef LZ4_STATIC_LINKING_ONLY_ENDIANNESS_INDEPENDENT_OUTPUT
 static U32 LZ4_readLE32(const void* memPtr)
 {
     if (LZ4_isLittleEndian()) {
         return LZ4_read32(memPtr);
     } else {
         const BYTE* p = (const BYTE*)memPtr;
-        return (U32)p[0] | (p[1]<<8) | (p[2]<<16) | (p[3]<<24);
+        return (U32)p[0] | ((U32)p[1]<<8) | ((U32)p[2]<<16) | ((U32)p[3]<<24);
     }
 }
-#endif
 
 static void LZ4_writeLE16(void* memPtr, U16 value)
 {
@@ -460,6 +487,19 @@ static void LZ4_writeLE16(void* memPtr, U16 value)
     }
 }
 
+static void LZ4_writeLE32(void* memPtr, U32 value)
+{
+    if (LZ4_isLittleEndian()) {
+        LZ4_write32(memPtr, value);
+    } else {
+        BYTE* p = (BYTE*)memPtr;
+        p[0] = (BYTE) value;
+        p[1] = (BYTE)(value>>8);
+        p[2] = (BYTE)(value>>16);
+        p[3] = (BYTE)(value>>24);
+    }
+}
+
 /* customized variant of memcpy, which can overwrite up to 8 bytes beyond dstEnd */
 LZ4_FORCE_INLINE
 void LZ4_wildCopy8(void* dstPtr, const void* srcPtr, void* dstEnd)
@@ -471,6 +511,21 @@ void LZ4_wildCopy8(void* dstPtr, const void* srcPtr, void* dstEnd)
     do { LZ4_memcpy(d,s,8); d+=8; s+=8; } while (d<e);
 }
 
+/* variant of LZ4_wildCopy8(), for long literal runs :
+ * copies 32 bytes per loop (as 2 vector registers) as long as it doesn't write beyond dstEnd,
+ * then finishes with LZ4_wildCopy8() only if some bytes remain,
+ * hence overwrites at most 7 bytes beyond dstEnd, like LZ4_wildCopy8() */
+LZ4_FORCE_INLINE
+void LZ4_wildCopyLong(void* dstPtr, const void* srcPtr, void* dstEnd)
+{
+    BYTE* d = (BYTE*)dstPtr;
+    const BYTE* s = (const BYTE*)srcPtr;
+    BYTE* const e = (BYTE*)dstEnd;
+
+    while (e - d >= 32) { LZ4_memcpy(d,s,16); LZ4_memcpy(d+16,s+16,16); d+=32; s+=32; }
+    if (d < e) LZ4_wildCopy8(d, s, e);
+}
+
 static const unsigned inc32table[8] = {0, 1, 2,  1,  0,  4, 4, 4};
 static const int      dec64table[8] = {0, 0, 0, -1, -4,  1, 2, 3};
 
@@ -490,6 +545,42 @@ static const int      dec64table[8] = {0, 0, 0, -1, -4,  1, 2, 3};
 #  endif
 #endif
 
+/*
+ * LZ4_VECTOR_COPY :
+ * When enabled, the fast decoding loop replicates matches with a short offset (< 16)
+ * using a byte shuffle (pshufb on x86-64, tbl on aarch64), which expands the pattern
+ * into a 16-byte register (32-byte with AVX2) written with one store per step.
+ * Enabled by default on x86-64, can be disabled by setting LZ4_VECTOR_COPY to 0.
+ * The aarch64 variant is opt-in (LZ4_VECTOR_COPY=1) : it hasn't been validated on aarch64 hardware yet.
+ */
+#ifndef LZ4_VECTOR_COPY
+#  if (defined(__x86_64__) || defined(_M_X64)) && !defined(_M_ARM64EC) && (defined(__GNUC__) || defined(__clang__) || defined(__SSSE3__) || defined(__AVX2__))
+#    define LZ4_VECTOR_COPY 1
+#  else
+#    define LZ4_VECTOR_COPY 0
+#  endif
+#endif
+#if LZ4_VECTOR_COPY && !( ((defined(__x86_64__) || defined(_M_X64)) && !defined(_M_ARM64EC) && (defined(__GNUC__) || defined(__clang__) || defined(__SSSE3__) || defined(__AVX2__))) \
+                       || (defined(__aarch64__) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN) && (defined(__GNUC__) || defined(__clang__))) )
+#  error "LZ4_VECTOR_COPY requires x86-64, or little-endian aarch64 with NEON and gcc or clang"
+#endif
+
+/*
+ * LZ4_COPY_DISPATCH :
+ * SSSE3 and AVX2 are not part of baseline x86-64.
+ * Unless enabled at compile time (-mssse3, -mavx2), select their pattern kernels at runtime,
+ * using __builtin_cpu_supports(), so that distribution builds still benefit from them.
+ */
+#ifndef LZ4_COPY_DISPATCH
+#  if LZ4_VECTOR_COPY && defined(__x86_64__) && !defined(__AVX2__) && !LZ4_FREESTANDING \
+   && ( (defined(__clang__) && (__clang_major__ >= 4)) \
+     || (!defined(__clang__) && defined(__GNUC__) && (__GNUC__ >= 5)) )
+#    define LZ4_COPY_DISPATCH 1
+#  else
+#    define LZ4_COPY_DISPATCH 0
+#  endif
+#endif
+
 #if LZ4_FAST_DEC_LOOP
 
 LZ4_FORCE_INLINE void
@@ -528,15 +619,136 @@ LZ4_wildCopy32(void* dstPtr, const void* srcPtr, void* dstEnd)
     do { LZ4_memcpy(d,s,16); LZ4_memcpy(d+16,s+16,16); d+=32; s+=32; } while (d<e);
 }
 
+#if LZ4_VECTOR_COPY
+#  if defined(__x86_64__) || defined(_M_X64)
+#    include <immintrin.h>   /* SSSE3, AVX2 */
+#  else
+#    include <arm_neon.h>
+#  endif
+
+/* Pattern kernels :
+ * the first @offset bytes at @srcPtr are expanded into a full register, using shuffle indexes (i % offset).
+ * The register is then written every (register size rounded down to a multiple of @offset) bytes,
+ * so that the pattern stays in phase.
+ * Offset 0 only happens with malformed input : it's just prevented from looping forever. */
+static const BYTE LZ4_patternIndexes[16][32] = {
+    { 0 },
+    { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 },
+    { 0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1, 0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1 },
+    { 0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0, 1,2,0,1,2,0,1,2,0,1,2,0,1,2,0,1 },
+    { 0,1,2,3,0,1,2,3,0,1,2,3,0,1,2,3, 0,1,2,3,0,1,2,3,0,1,2,3,0,1,2,3 },
+    { 0,1,2,3,4,0,1,2,3,4,0,1,2,3,4,0, 1,2,3,4,0,1,2,3,4,0,1,2,3,4,0,1 },
+    { 0,1,2,3,4,5,0,1,2,3,4,5,0,1,2,3, 4,5,0,1,2,3,4,5,0,1,2,3,4,5,0,1 },
+    { 0,1,2,3,4,5,6,0,1,2,3,4,5,6,0,1, 2,3,4,5,6,0,1,2,3,4,5,6,0,1,2,3 },
+    { 0,1,2,3,4,5,6,7,0,1,2,3,4,5,6,7, 0,1,2,3,4,5,6,7,0,1,2,3,4,5,6,7 },
+    { 0,1,2,3,4,5,6,7,8,0,1,2,3,4,5,6, 7,8,0,1,2,3,4,5,6,7,8,0,1,2,3,4 },
+    { 0,1,2,3,4,5,6,7,8,9,0,1,2,3,4,5, 6,7,8,9,0,1,2,3,4,5,6,7,8,9,0,1 },
+    { 0,1,2,3,4,5,6,7,8,9,10,0,1,2,3,4, 5,6,7,8,9,10,0,1,2,3,4,5,6,7,8,9 },
+    { 0,1,2,3,4,5,6,7,8,9,10,11,0,1,2,3, 4,5,6,7,8,9,10,11,0,1,2,3,4,5,6,7 },
+    { 0,1,2,3,4,5,6,7,8,9,10,11,12,0,1,2, 3,4,5,6,7,8,9,10,11,12,0,1,2,3,4,5 },
+    { 0,1,2,3,4,5,6,7,8,9,10,11,12,13,0,1, 2,3,4,5,6,7,8,9,10,11,12,13,0,1,2,3 },
+    { 0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,0, 1,2,3,4,5,6,7,8,9,10,11,12,13,14,0,1 },
+};
+static const BYTE LZ4_patternStep16[16] = { 16, 16, 16, 15, 16, 15, 12, 14, 16, 9, 10, 11, 12, 13, 14, 15 };
+
+#  if defined(__x86_64__) || defined(_M_X64)
+
+#    if defined(__SSSE3__) || defined(__AVX2__) || LZ4_COPY_DISPATCH
+#      if LZ4_COPY_DISPATCH
+__attribute__((target("ssse3"))) static
+#      else
+LZ4_FORCE_INLINE
+#      endif
+void LZ4_memcpy_pattern16(BYTE* dstPtr, const BYTE* srcPtr, BYTE* dstEnd, size_t offset)
+{
+    __m128i const src = _mm_loadu_si128((const __m128i*)(const void*)srcPtr);
+    __m128i const pattern = _mm_shuffle_epi8(src, _mm_loadu_si128((const __m128i*)(const void*)LZ4_patternIndexes[offset]));
+    size_t const step = LZ4_patternStep16[offset];
+    do {
+        _mm_storeu_si128((__m128i*)(void*)dstPtr, pattern);
+        dstPtr += step;
+    } while (dstPtr < dstEnd);
+}
+#    endif
+
+#    if defined(__AVX2__) || LZ4_COPY_DISPATCH
+static const BYTE LZ4_patternStep32[16] = { 32, 32, 32, 30, 32, 30, 30, 28, 32, 27, 30, 22, 24, 26, 28, 30 };
+
+#      if LZ4_COPY_DISPATCH
+__attribute__((target("avx2"))) static
+#      else
+LZ4_FORCE_INLINE
+#      endif
+void LZ4_memcpy_pattern32(BYTE* dstPtr, const BYTE* srcPtr, BYTE* dstEnd, size_t offset)
+{
+    /* both 128-bit lanes receive the same source bytes, since vpshufb doesn't cross lanes */
+    __m256i const src = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(const void*)srcPtr));
+    __m256i const pattern = _mm256_shuffle_epi8(src, _mm256_loadu_si256((const __m256i*)(const void*)LZ4_patternIndexes[offset]));
+    size_t const step = LZ4_patternStep32[offset];
+    do {
+        _mm256_storeu_si256((__m256i*)(void*)dstPtr, pattern);
+        dstPtr += step;
+    } while (dstPtr < dstEnd);
+}
+#    endif
+
+/* @return : 1 if the match was copied, 0 if no vector kernel is available */
+LZ4_FORCE_INLINE int LZ4_memcpy_pattern(BYTE* dstPtr, const BYTE* srcPtr, BYTE* dstEnd, size_t offset)
+{
+#    if defined(__AVX2__)
+    LZ4_memcpy_pattern32(dstPtr, srcPtr, dstEnd, offset);
+    return 1;
+#    elif defined(__SSSE3__) && !LZ4_COPY_DISPATCH
+    LZ4_memcpy_pattern16(dstPtr, srcPtr, dstEnd, offset);
+    return 1;
+#    elif LZ4_COPY_DISPATCH
+    static int cpuKernel = -1;   /* 2:avx2, 1:ssse3, 0:none; resolved on first use, instead of querying the cpu on every match.
+                                  * Any thread may get there first : relaxed atomics, since they all store the same value */
+    int kernel = __atomic_load_n(&cpuKernel, __ATOMIC_RELAXED);
+    if (unlikely(kernel < 0)) {
+        kernel = __builtin_cpu_supports("avx2") ? 2 : __builtin_cpu_supports("ssse3") ? 1 : 0;
+        __atomic_store_n(&cpuKernel, kernel, __ATOMIC_RELAXED);
+    }
+    if (kernel == 2) { LZ4_memcpy_pattern32(dstPtr, srcPtr, dstEnd, offset); return 1; }
+    if (kernel == 1) { LZ4_memcpy_pattern16(dstPtr, srcPtr, dstEnd, offset); return 1; }
+    return 0;
+#    else
+    (void)dstPtr; (void)srcPtr; (void)dstEnd; (void)offset;
+    (void)LZ4_patternIndexes; (void)LZ4_patternStep16;
+    return 0;
+#    endif
+}
+
+#  else  /* aarch64 */
+
+LZ4_FORCE_INLINE int LZ4_memcpy_pattern(BYTE* dstPtr, const BYTE* srcPtr, BYTE* dstEnd, size_t offset)
+{
+    uint8x16_t const pattern = vqtbl1q_u8(vld1q_u8(srcPtr), vld1q_u8(LZ4_patternIndexes[offset]));
+    size_t const step = LZ4_patternStep16[offset];
+    do {
+        vst1q_u8(dstPtr, pattern);
+        dstPtr += step;
+    } while (dstPtr < dstEnd);
+    return 1;
+}
+
+#  endif
+#endif  /* LZ4_VECTOR_COPY */
+
 /* LZ4_memcpy_using_offset()  presumes :
  * - dstEnd >= dstPtr + MINMATCH
- * - there is at least 12 bytes available to write after dstEnd */
+ * - there is at least 32 bytes available to write after dstEnd (vector kernels),
+ *   12 bytes for the scalar variant */
 LZ4_FORCE_INLINE void
 LZ4_memcpy_using_offset(BYTE* dstPtr, const BYTE* srcPtr, BYTE* dstEnd, const size_t offset)
 {
     BYTE v[8];
 
     assert(dstEnd >= dstPtr + MINMATCH);
+    assert(offset < 16);
+#if LZ4_VECTOR_COPY
+    if (LZ4_memcpy_pattern(dstPtr, srcPtr, dstEnd, offset)) return;
+#endif
 
     switch(offset) {
     case 1:
@@ -675,6 +887,142 @@ static unsigned LZ4_NbCommonBytes (reg_t val)
 }
 
 
+/*
+ * LZ4_VECTOR_COUNT :
+ * When enabled, LZ4_count() compares long matches 16 bytes at a time (SSE2 on x86-64, NEON on aarch64),
+ * or 32 bytes at a time when AVX2 is available.
+ * It only kicks in after the first register-wide comparison, so short matches are unaffected.
+ * Enabled by default on x86-64, can be disabled by setting LZ4_VECTOR_COUNT to 0.
+ * The NEON variant is opt-in (LZ4_VECTOR_COUNT=1) : it hasn't been validated on aarch64 hardware yet.
+ */
+#ifndef LZ4_VECTOR_COUNT
+#  if !defined(LZ4_FORCE_SW_BITCOUNT) && (defined(__x86_64__) || defined(_M_X64)) && !defined(_M_ARM64EC)
+#    define LZ4_VECTOR_COUNT 1
+#  else
+#    define LZ4_VECTOR_COUNT 0
+#  endif
+#endif
+#if LZ4_VECTOR_COUNT && !( ((defined(__x86_64__) || defined(_M_X64)) && !defined(_M_ARM64EC)) \
+                        || (defined(__aarch64__) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN) && (defined(__GNUC__) || defined(__clang__))) )
+#  error "LZ4_VECTOR_COUNT requires x86-64, or little-endian aarch64 with NEON and gcc or clang"
+#endif
+
+/*
+ * LZ4_COUNT_AVX2_DISPATCH :
+ * Select the AVX2 variant of LZ4_count() at runtime, using __builtin_cpu_supports(),
+ * so that binaries compiled for baseline x86-64 still benefit from it.
+ * Not needed when compiling with -mavx2, since AVX2 is then employed unconditionally.
+ */
+#ifndef LZ4_COUNT_AVX2_DISPATCH
+#  if LZ4_VECTOR_COUNT && defined(__x86_64__) && !defined(__AVX2__) && !LZ4_FREESTANDING \
+   && ( (defined(__clang__) && (__clang_major__ >= 4)) \
+     || (!defined(__clang__) && defined(__GNUC__) && (__GNUC__ >= 5)) )
+#    define LZ4_COUNT_AVX2_DISPATCH 1
+#  else
+#    define LZ4_COUNT_AVX2_DISPATCH 0
+#  endif
+#endif
+
+#if LZ4_VECTOR_COUNT
+#  if defined(__x86_64__) || defined(_M_X64)
+#    include <emmintrin.h>   /* SSE2 */
+#    if defined(__AVX2__) || LZ4_COUNT_AVX2_DISPATCH
+#      include <immintrin.h>   /* AVX2 */
+#    endif
+#  else
+#    include <arm_neon.h>
+#  endif
+
+#  if defined(__x86_64__) || defined(_M_X64)
+static unsigned LZ4_ctz32(U32 val)
+{
+    assert(val != 0);
+#    if defined(_MSC_VER)
+    {   unsigned long r;
+        _BitScanForward(&r, val);
+        return (unsigned)r;
+    }
+#    else
+    return (unsigned)__builtin_ctz(val);
+#    endif
+}
+
+/* LZ4_count16() :
+ * compares 16 bytes per loop, while at least 16 bytes remain before pInLimit.
+ * @return : nb of identical bytes.
+ *  When the result is < (pInLimit - pIn) - 15, a mismatch was found at this position.
+ *  Otherwise, the caller must finish the comparison of remaining bytes. */
+LZ4_FORCE_INLINE size_t LZ4_count16(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
+{
+    const BYTE* const pStart = pIn;
+    while (pInLimit - pIn >= 16) {
+        __m128i const in = _mm_loadu_si128((const __m128i*)(const void*)pIn);
+        __m128i const match = _mm_loadu_si128((const __m128i*)(const void*)pMatch);
+        U32 const equal = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(in, match));
+        if (equal != 0xFFFF) return (size_t)(pIn - pStart) + LZ4_ctz32(~equal);
+        pIn += 16; pMatch += 16;
+    }
+    return (size_t)(pIn - pStart);
+}
+
+#    if defined(__AVX2__) || LZ4_COUNT_AVX2_DISPATCH
+#      if LZ4_COUNT_AVX2_DISPATCH
+__attribute__((target("avx2"))) static
+#      else
+LZ4_FORCE_INLINE
+#      endif
+size_t LZ4_count32(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
+{
+    const BYTE* const pStart = pIn;
+    while (pInLimit - pIn >= 32) {
+        __m256i const in = _mm256_loadu_si256((const __m256i*)(const void*)pIn);
+        __m256i const match = _mm256_loadu_si256((const __m256i*)(const void*)pMatch);
+        U32 const equal = (U32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, match));
+        if (equal != 0xFFFFFFFF) return (size_t)(pIn - pStart) + LZ4_ctz32(~equal);
+        pIn += 32; pMatch += 32;
+    }
+    return (size_t)(pIn - pStart);
+}
+#    endif
+
+#  else  /* aarch64 */
+
+LZ4_FORCE_INLINE size_t LZ4_count16(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
+{
+    const BYTE* const pStart = pIn;
+    while (pInLimit - pIn >= 16) {
+        uint8x16_t const equal = vceqq_u8(vld1q_u8(pIn), vld1q_u8(pMatch));
+        /* narrow the comparison result into 4 bits per byte */
+        U64 const mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0);
+        if (mask != ~(U64)0) return (size_t)(pIn - pStart) + ((unsigned)__builtin_ctzll(~mask) >> 2);
+        pIn += 16; pMatch += 16;
+    }
+    return (size_t)(pIn - pStart);
+}
+
+#  endif
+
+LZ4_FORCE_INLINE size_t LZ4_count_vector(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
+{
+#  if defined(__AVX2__)
+    return LZ4_count32(pIn, pMatch, pInLimit);
+#  elif LZ4_COUNT_AVX2_DISPATCH
+    static int hasAVX2 = -1;   /* resolved on first use, instead of querying the cpu on every match.
+                                * Any thread may get there first : relaxed atomics, since they all store the same value */
+    int avx2 = __atomic_load_n(&hasAVX2, __ATOMIC_RELAXED);
+    if (unlikely(avx2 < 0)) {
+        avx2 = (__builtin_cpu_supports("avx2") != 0);
+        __atomic_store_n(&hasAVX2, avx2, __ATOMIC_RELAXED);
+    }
+    if (avx2) return LZ4_count32(pIn, pMatch, pInLimit);
+    return LZ4_count16(pIn, pMatch, pInLimit);
+#  else
+    return LZ4_count16(pIn, pMatch, pInLimit);
+#  endif
+}
+#endif  /* LZ4_VECTOR_COUNT */
+
+
 #define STEPSIZE sizeof(reg_t)
 LZ4_FORCE_INLINE
 unsigned LZ4_count(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
@@ -689,6 +1037,14 @@ unsigned LZ4_count(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
             return LZ4_NbCommonBytes(diff);
     }   }
 
+#if LZ4_VECTOR_COUNT
+    /* long match : compare multiple registers per loop.
+     * Remaining bytes, or the exact mismatch position, are handled below. */
+    {   size_t const n = LZ4_count_vector(pIn, pMatch, pInLimit);
+        pIn += n; pMatch += n;
+    }
+#endif
+
     while (likely(pIn < pInLimit-(STEPSIZE-1))) {
         reg_t const diff = LZ4_read_ARCH(pMatch) ^ LZ4_read_ARCH(pIn);
         if (!diff) { pIn+=STEPSIZE; pMatch+=STEPSIZE; continue; }
@@ -774,37 +1130,64 @@ int LZ4_decompress_safe_partial_forceExtDict(const char* source, char* dest,
 /*-******************************
 *  Compression functions
 ********************************/
-LZ4_FORCE_INLINE U32 LZ4_hash4(U32 sequence, tableType_t const tableType)
+/* @hashLog : log2 of the number of U32 cells in the hash table (LZ4_HASHLOG by default).
+ *            byU16 tables feature twice more cells within the same memory budget. */
+LZ4_FORCE_INLINE U32 LZ4_hash4(U32 sequence, tableType_t const tableType, U32 const hashLog)
 {
     if (tableType == byU16)
-        return ((sequence * 2654435761U) >> ((MINMATCH*8)-(LZ4_HASHLOG+1)));
+        return ((sequence * 2654435761U) >> ((MINMATCH*8)-(hashLog+1)));
     else
-        return ((sequence * 2654435761U) >> ((MINMATCH*8)-LZ4_HASHLOG));
+        return ((sequence * 2654435761U) >> ((MINMATCH*8)-hashLog));
 }
 
-LZ4_FORCE_INLINE U32 LZ4_hash5(U64 sequence, tableType_t const tableType)
+LZ4_FORCE_INLINE U32 LZ4_hash5(U64 sequence, tableType_t const tableType, U32 const hashLog)
 {
-    const U32 hashLog = (tableType == byU16) ? LZ4_HASHLOG+1 : LZ4_HASHLOG;
+    const U32 tableLog = (tableType == byU16) ? hashLog+1 : hashLog;
     if (LZ4_isLittleEndian()) {
         const U64 prime5bytes = 889523592379ULL;
-        return (U32)(((sequence << 24) * prime5bytes) >> (64 - hashLog));
+        return (U32)(((sequence << 24) * prime5bytes) >> (64 - tableLog));
     } else {
         const U64 prime8bytes = 11400714785074694791ULL;
-        return (U32)(((sequence >> 24) * prime8bytes) >> (64 - hashLog));
+        return (U32)(((sequence >> 24) * prime8bytes) >> (64 - tableLog));
     }
 }
 
-LZ4_FORCE_INLINE U32 LZ4_hashPosition(const void* const p, tableType_t const tableType)
+LZ4_FORCE_INLINE U32 LZ4_hashPosition(const void* const p, tableType_t const tableType, U32 const hashLog)
 {
-    if ((sizeof(reg_t)==8) && (tableType != byU16)) return LZ4_hash5(LZ4_read_ARCH(p), tableType);
+    if ((sizeof(reg_t)==8) && (tableType != byU16)) return LZ4_hash5(LZ4_read_ARCH(p), tableType, hashLog);
 
 #ifdef LZ4_STATIC_LINKING_ONLY_ENDIANNESS_INDEPENDENT_OUTPUT
-    return LZ4_hash4(LZ4_readLE32(p), tableType);
+    return LZ4_hash4(LZ4_readLE32(p), tableType, hashLog);
 #else
-    return LZ4_hash4(LZ4_read32(p), tableType);
+    return LZ4_hash4(LZ4_read32(p), tableType, hashLog);
 #endif
 }
 
+/* LZ4_stream_hashLog() :
+ * hashLog==0 designates the compile-time default, LZ4_HASHLOG.
+ * Other values are set by LZ4_initStream_advanced(). */
+LZ4_FORCE_INLINE U32 LZ4_stream_hashLog(const LZ4_stream_t_internal* cctx)
+{
+    if (cctx->hashLog == 0) return LZ4_HASHLOG;
+    assert(cctx->hashLog >= LZ4_STREAM_HASHLOG_MIN);
+    assert(cctx->hashLog <= LZ4_STREAM_HASHLOG_MAX);
+    return cctx->hashLog;
+}
+
+static size_t LZ4_hashTableSize(U32 hashLog)
+{
+    return sizeof(U32) << hashLog;
+}
+
+/* LZ4_stream_sizeof() :
+ * size of a state employing a hash table of (1 << hashLog) cells.
+ * Since the hash table is the last member of LZ4_stream_t_internal,
+ * it can be shorter or longer than the statically allocated one. */
+static size_t LZ4_stream_sizeof(U32 hashLog)
+{
+    return offsetof(LZ4_stream_t_internal, hashTable) + LZ4_hashTableSize(hashLog);
+}
+
 LZ4_FORCE_INLINE void LZ4_clearHash(U32 h, void* tableBase, tableType_t const tableType)
 {
     switch (tableType)
@@ -838,9 +1221,9 @@ LZ4_FORCE_INLINE void LZ4_putPositionOnHash(const BYTE* p, U32 h,
     hashTable[h] = p;
 }
 
-LZ4_FORCE_INLINE void LZ4_putPosition(const BYTE* p, void* tableBase, tableType_t tableType)
+LZ4_FORCE_INLINE void LZ4_putPosition(const BYTE* p, void* tableBase, tableType_t tableType, U32 hashLog)
 {
-    U32 const h = LZ4_hashPosition(p, tableType);
+    U32 const h = LZ4_hashPosition(p, tableType, hashLog);
     LZ4_putPositionOnHash(p, h, tableBase, tableType);
 }
 
@@ -855,12 +1238,12 @@ LZ4_FORCE_INLINE U32 LZ4_getIndexOnHash(U32 h, const void* tableBase, tableType_
     LZ4_STATIC_ASSERT(LZ4_MEMORY_USAGE > 2);
     if (tableType == byU32) {
         const U32* const hashTable = (const U32*) tableBase;
-        assert(h < (1U << (LZ4_MEMORY_USAGE-2)));
+        assert(h < (1U << (LZ4_MEMORY_USAGE_MAX-2)));
         return hashTable[h];
     }
     if (tableType == byU16) {
         const U16* const hashTable = (const U16*) tableBase;
-        assert(h < (1U << (LZ4_MEMORY_USAGE-1)));
+        assert(h < (1U << (LZ4_MEMORY_USAGE_MAX-1)));
         return hashTable[h];
     }
     assert(0); return 0;  /* forbidden case */
@@ -874,9 +1257,9 @@ static const BYTE* LZ4_getPositionOnHash(U32 h, const void* tableBase, tableType
 
 LZ4_FORCE_INLINE const BYTE*
 LZ4_getPosition(const BYTE* p,
-                const void* tableBase, tableType_t tableType)
+                const void* tableBase, tableType_t tableType, U32 hashLog)
 {
-    U32 const h = LZ4_hashPosition(p, tableType);
+    U32 const h = LZ4_hashPosition(p, tableType, hashLog);
     return LZ4_getPositionOnHash(h, tableBase, tableType);
 }
 
@@ -897,7 +1280,7 @@ LZ4_prepareTable(LZ4_stream_t_internal* const cctx,
           || inputSize >= 4 KB)
         {
             DEBUGLOG(4, "LZ4_prepareTable: Resetting table in %p", cctx);
-            MEM_INIT(cctx->hashTable, 0, LZ4_HASHTABLESIZE);
+            MEM_INIT(cctx->hashTable, 0, LZ4_hashTableSize(LZ4_stream_hashLog(cctx)));
             cctx->currentOffset = 0;
             cctx->tableType = (U32)clearedTable;
         } else {
@@ -944,6 +1327,7 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
     const BYTE* ip = (const BYTE*)source;
 
     U32 const startIndex = cctx->currentOffset;
+    U32 const hashLog = LZ4_stream_hashLog(cctx);
     const BYTE* base = (const BYTE*)source - startIndex;
     const BYTE* lowLimit;
 
@@ -980,6 +1364,7 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
     assert(ip != NULL);
     if (tableType == byU16) assert(inputSize<LZ4_64Klimit);  /* Size too large (not within 64K limit) */
     if (tableType == byPtr) assert(dictDirective==noDict);   /* only supported use case with byPtr */
+    if (dictDirective == usingDictCtx) assert(LZ4_stream_hashLog(dictCtx) == hashLog);   /* tables must be indexed the same way */
     /* If init conditions are not met, we don't have to mark stream
      * as having dirty context, since no action was taken yet */
     if (outputDirective == fillOutput && maxOutputSize < 1) { return 0; } /* Impossible to store anything */
@@ -1002,13 +1387,13 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
     if (inputSize<LZ4_minLength) goto _last_literals;        /* Input too small, no compression (all literals) */
 
     /* First Byte */
-    {   U32 const h = LZ4_hashPosition(ip, tableType);
+    {   U32 const h = LZ4_hashPosition(ip, tableType, hashLog);
         if (tableType == byPtr) {
             LZ4_putPositionOnHash(ip, h, cctx->hashTable, byPtr);
         } else {
             LZ4_putIndexOnHash(startIndex, h, cctx->hashTable, tableType);
     }   }
-    ip++; forwardH = LZ4_hashPosition(ip, tableType);
+    ip++; forwardH = LZ4_hashPosition(ip, tableType, hashLog);
 
     /* Main Loop */
     for ( ; ; ) {
@@ -1031,7 +1416,7 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
                 assert(ip < mflimitPlusOne);
 
                 match = LZ4_getPositionOnHash(h, cctx->hashTable, tableType);
-                forwardH = LZ4_hashPosition(forwardIp, tableType);
+                forwardH = LZ4_hashPosition(forwardIp, tableType, hashLog);
                 LZ4_putPositionOnHash(ip, h, cctx->hashTable, tableType);
 
             } while ( (match+LZ4_DISTANCE_MAX < ip)
@@ -1081,7 +1466,7 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
                 } else {   /* single continuous memory segment */
                     match = base + matchIndex;
                 }
-                forwardH = LZ4_hashPosition(forwardIp, tableType);
+                forwardH = LZ4_hashPosition(forwardIp, tableType, hashLog);
                 LZ4_putIndexOnHash(current, h, cctx->hashTable, tableType);
 
                 DEBUGLOG(7, "candidate at pos=%u  (offset=%u \n", matchIndex, current - matchIndex);
@@ -1129,7 +1514,7 @@ LZ4_FORCE_INLINE int LZ4_compress_generic_validated(
             else *token = (BYTE)(litLength<<ML_BITS);
 
             /* Copy Literals */
-            LZ4_wildCopy8(op, anchor, op+litLength);
+            LZ4_wildCopyLong(op, anchor, op+litLength);
             op+=litLength;
             DEBUGLOG(6, "seq.start:%i, literals=%u, match.start:%i",
                         (int)(anchor-(const BYTE*)source), litLength, (int)(ip-(const BYTE*)source));
@@ -1201,7 +1586,7 @@ _next_match:
                         const BYTE* ptr;
                         DEBUGLOG(5, "Clearing %u positions", (U32)(filledIp - ip));
                         for (ptr = ip; ptr <= filledIp; ++ptr) {
-                            U32 const h = LZ4_hashPosition(ptr, tableType);
+                            U32 const h = LZ4_hashPosition(ptr, tableType, hashLog);
                             LZ4_clearHash(h, cctx->hashTable, tableType);
                         }
                     }
@@ -1233,7 +1618,7 @@ _next_match:
         if (ip >= mflimitPlusOne) break;
 
         /* Fill table */
-        {   U32 const h = LZ4_hashPosition(ip-2, tableType);
+        {   U32 const h = LZ4_hashPosition(ip-2, tableType, hashLog);
             if (tableType == byPtr) {
                 LZ4_putPositionOnHash(ip-2, h, cctx->hashTable, byPtr);
             } else {
@@ -1244,15 +1629,15 @@ _next_match:
         /* Test next position */
         if (tableType == byPtr) {
 
-            match = LZ4_getPosition(ip, cctx->hashTable, tableType);
-            LZ4_putPosition(ip, cctx->hashTable, tableType);
+            match = LZ4_getPosition(ip, cctx->hashTable, tableType, hashLog);
+            LZ4_putPosition(ip, cctx->hashTable, tableType, hashLog);
             if ( (match+LZ4_DISTANCE_MAX >= ip)
               && (LZ4_read32(match) == LZ4_read32(ip)) )
             { token=op++; *token=0; goto _next_match; }
 
         } else {   /* byU32, byU16 */
 
-            U32 const h = LZ4_hashPosition(ip, tableType);
+            U32 const h = LZ4_hashPosition(ip, tableType, hashLog);
             U32 const current = (U32)(ip-base);
             U32 matchIndex = LZ4_getIndexOnHash(h, cctx->hashTable, tableType);
             assert(matchIndex < current);
@@ -1295,7 +1680,7 @@ _next_match:
         }
 
         /* Prepare next loop */
-        forwardH = LZ4_hashPosition(++ip, tableType);
+        forwardH = LZ4_hashPosition(++ip, tableType, hashLog);
 
     }
 
@@ -1402,6 +1787,90 @@ int LZ4_compress_fast_extState(void* state, const char* source, char* dest, int
     }
 }
 
+/* LZ4_looksIncompressible() :
+ * Samples LZ4_PROBE_NB_SAMPLES windows of LZ4_PROBE_SAMPLE_SIZE bytes, spread over the input.
+ * Input looks incompressible when both conditions are met :
+ * - byte histogram of samples is flat (order-0 entropy close to 8 bits per byte)
+ * - almost no sampled 4-byte sequence repeats (no match for the LZ4 search to find)
+ * Flatness is estimated without any log(), from the sum of squared counts :
+ * n * sum(count^2) * 256 == n^2 + n * chi2, with chi2 ~= 255 +/- 23 for uniformly distributed bytes.
+ * The probe costs a small fraction of the search it avoids, even in fast mode. */
+#define LZ4_PROBE_NB_SAMPLES    16
+#define LZ4_PROBE_SAMPLE_SIZE   64
+#define LZ4_PROBE_MIN_SIZE      (8 KB)
+#define LZ4_PROBE_HASHLOG       8
+#define LZ4_PROBE_CHI2_MAX      384
+int LZ4_looksIncompressible(const char* src, int srcSize)
+{
+    U32 count[256];
+    U32 seen[1 << LZ4_PROBE_HASHLOG];
+    U32 const n = LZ4_PROBE_NB_SAMPLES * LZ4_PROBE_SAMPLE_SIZE;
+    U32 nbRepeats = 0;
+    U64 sumSq = 0;
+    int s;
+
+    if (src == NULL || srcSize < LZ4_PROBE_MIN_SIZE) return 0;   /* not worth it : let the compressor decide */
+    MEM_INIT(count, 0, sizeof(count));
+    MEM_INIT(seen, 0, sizeof(seen));
+
+    for (s = 0; s < LZ4_PROBE_NB_SAMPLES; s++) {
+        /* last sample ends exactly at end of input */
+        size_t const start = (size_t)(srcSize - LZ4_PROBE_SAMPLE_SIZE) / (LZ4_PROBE_NB_SAMPLES - 1) * (size_t)s;
+        const BYTE* const sample = (const BYTE*)src + start;
+        int i;
+        for (i = 0; i < LZ4_PROBE_SAMPLE_SIZE; i += 4) {
+            /* 4-byte sequences, every 2 positions, so that repeats at any even distance are seen */
+            U32 const seq0 = LZ4_read32(sample + i) | 1;   /* 0 means empty */
+            U32 const seq1 = (i + 6 <= LZ4_PROBE_SAMPLE_SIZE) ? LZ4_read32(sample + i + 2) | 1 : seq0;
+            U32 const h0 = (seq0 * 2654435761U) >> (32 - LZ4_PROBE_HASHLOG);
+            U32 const h1 = (seq1 * 2654435761U) >> (32 - LZ4_PROBE_HASHLOG);
+            count[sample[i]]++; count[sample[i+1]]++; count[sample[i+2]]++; count[sample[i+3]]++;
+            nbRepeats += (seen[h0] == seq0); seen[h0] = seq0;
+            nbRepeats += (seen[h1] == seq1) & (seq1 != seq0); seen[h1] = seq1;
+    }   }
+
+    {   int b;
+        for (b = 0; b < 256; b++) sumSq += (U64)count[b] * count[b];
+    }
+    DEBUGLOG(5, "LZ4_looksIncompressible: chi2=%.1f, repeats=%u",
+                ((double)sumSq * 256 - (double)n * n) / n, nbRepeats);
+    if (sumSq * 256 > (U64)n * n + (U64)n * LZ4_PROBE_CHI2_MAX) return 0;   /* not flat */
+    if (nbRepeats * 100 > n / 2) return 0;   /* more than 1% of sampled sequences repeat */
+    return 1;
+}
+
+/* LZ4_compress_literalsOnly() :
+ * valid LZ4 block, made of a single literal run.
+ * @return : compressed size, or 0 if @dstCapacity is too small */
+static int LZ4_compress_literalsOnly(const char* src, char* dst, int srcSize, int dstCapacity)
+{
+    BYTE* op = (BYTE*)dst;
+    size_t const lastRun = (size_t)srcSize;
+    if ((size_t)dstCapacity < lastRun + 1 + ((lastRun+255-RUN_MASK)/255)) return 0;
+    if (lastRun >= RUN_MASK) {
+        size_t accumulator = lastRun - RUN_MASK;
+        *op++ = RUN_MASK << ML_BITS;
+        for(; accumulator >= 255 ; accumulator-=255) *op++ = 255;
+        *op++ = (BYTE) accumulator;
+    } else {
+        *op++ = (BYTE)(lastRun<<ML_BITS);
+    }
+    LZ4_memcpy(op, src, lastRun);
+    op += lastRun;
+    return (int)(op - (BYTE*)dst);
+}
+
+int LZ4_compress_fast_extState_probe(void* state, const char* src, char* dst, int srcSize, int dstCapacity, int acceleration)
+{
+    if (LZ4_looksIncompressible(src, srcSize)) {
+        DEBUGLOG(5, "LZ4_compress_fast_extState_probe: input looks incompressible, skip search");
+        if (LZ4_initStream(state, sizeof(LZ4_stream_t)) == NULL) return 0;   /* same post-condition as LZ4_compress_fast_extState() */
+        if (dstCapacity < LZ4_compressBound(srcSize)) return 0;
+        return LZ4_compress_literalsOnly(src, dst, srcSize, dstCapacity);
+    }
+    return LZ4_compress_fast_extState(state, src, dst, srcSize, dstCapacity, acceleration);
+}
+
 /**
  * LZ4_compress_fast_extState_fastReset() :
  * A variant of LZ4_compress_fast_extState().
@@ -1450,6 +1919,69 @@ int LZ4_compress_fast_extState_fastReset(void* state, const char* src, char* dst
 }
 
 
+/**
+ * LZ4_compress_batch() :
+ * Within a batch, inputs < 64 KB keep re-using the same byU16 table, whatever their size,
+ * as long as indexes fit into 16 bits. Stale entries from previous items are then rejected
+ * by the dictSmall check, which is cheaper than clearing the table between items.
+ * Larger inputs follow the same path as LZ4_compress_fast_extState_fastReset().
+ */
+int LZ4_compress_batch(void* state, LZ4_batchItem_t* items, int nbItems, int acceleration)
+{
+    LZ4_stream_t_internal* const ctx = &((LZ4_stream_t*)state)->internal_donotuse;
+    int nbCompressed = 0;
+    int n;
+    if (acceleration < 1) acceleration = LZ4_ACCELERATION_DEFAULT;
+    if (acceleration > LZ4_ACCELERATION_MAX) acceleration = LZ4_ACCELERATION_MAX;
+    assert(ctx != NULL);
+    if (items == NULL) return 0;
+    DEBUGLOG(4, "LZ4_compress_batch: %i items", nbItems);
+
+    for (n = 0; n < nbItems; n++) {
+        const char* const src = items[n].src;
+        char* const dst = items[n].dst;
+        int const srcSize = items[n].srcSize;
+        int const dstCapacity = items[n].dstCapacity;
+        int cSize;
+
+        if (srcSize < 0) {
+            cSize = 0;
+        } else if (srcSize < LZ4_64Klimit) {
+            if ((tableType_t)ctx->tableType != byU16
+              || ctx->currentOffset + (U32)srcSize >= 0xFFFFU) {
+                if ((tableType_t)ctx->tableType != clearedTable) {
+                    DEBUGLOG(5, "LZ4_compress_batch: Resetting table before item %i", n);
+                    MEM_INIT(ctx->hashTable, 0, LZ4_hashTableSize(LZ4_stream_hashLog(ctx)));
+                    ctx->currentOffset = 0;
+                    ctx->tableType = (U32)clearedTable;
+            }   }
+            ctx->dictCtx = NULL;
+            ctx->dictionary = NULL;
+            ctx->dictSize = 0;
+            if (dstCapacity >= LZ4_compressBound(srcSize)) {
+                if (ctx->currentOffset) {
+                    cSize = LZ4_compress_generic(ctx, src, dst, srcSize, NULL, 0, notLimited, byU16, noDict, dictSmall, acceleration);
+                } else {
+                    cSize = LZ4_compress_generic(ctx, src, dst, srcSize, NULL, 0, notLimited, byU16, noDict, noDictIssue, acceleration);
+                }
+            } else {
+                if (ctx->currentOffset) {
+                    cSize = LZ4_compress_generic(ctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, byU16, noDict, dictSmall, acceleration);
+                } else {
+                    cSize = LZ4_compress_generic(ctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, byU16, noDict, noDictIssue, acceleration);
+                }
+            }
+        } else {
+            cSize = LZ4_compress_fast_extState_fastReset(state, src, dst, srcSize, dstCapacity, acceleration);
+        }
+
+        items[n].cSize = cSize;
+        nbCompressed += (cSize > 0);
+    }
+    return nbCompressed;
+}
+
+
 int LZ4_compress_fast(const char* src, char* dest, int srcSize, int dstCapacity, int acceleration)
 {
     int result;
@@ -1521,6 +2053,37 @@ int LZ4_compress_destSize(const char* src, char* dst, int* srcSizePtr, int targe
     return result;
 }
 
+/* Each source is compressed with limitedOutput into remaining space,
+ * which fails early as soon as a block can't fit, instead of re-trying with fillOutput.
+ * Blocks which are guaranteed to fit (remaining space >= LZ4_compressBound()) use the faster notLimited mode. */
+int LZ4_compress_destSize_multi(void* state,
+                                const char* const* srcs, const int* srcSizes, int nbSources,
+                                char* dst, int targetDstSize,
+                                int* blockOffsets, int acceleration)
+{
+    int pos = 0;
+    int n;
+    assert(state != NULL);
+    if (srcs == NULL || srcSizes == NULL || blockOffsets == NULL) return 0;
+    DEBUGLOG(4, "LZ4_compress_destSize_multi: %i sources into %i bytes", nbSources, targetDstSize);
+
+    blockOffsets[0] = 0;
+    for (n = 0; n < nbSources; n++) {
+        int const remaining = targetDstSize - pos;
+        int cSize;
+        if (srcSizes[n] < 0 || remaining <= 0) break;
+        cSize = LZ4_compress_fast_extState_fastReset(state, srcs[n], dst + pos, srcSizes[n], remaining, acceleration);
+        if (cSize <= 0) {
+            DEBUGLOG(5, "LZ4_compress_destSize_multi: source %i doesn't fit into remaining %i bytes", n, remaining);
+            break;   /* state remains valid for next _fastReset() calls */
+        }
+        assert(cSize <= remaining);
+        pos += cSize;
+        blockOffsets[n+1] = pos;
+    }
+    return n;
+}
+
 
 
 /*-******************************
@@ -1559,6 +2122,81 @@ LZ4_stream_t* LZ4_initStream (void* buffer, size_t size)
     return (LZ4_stream_t*)buffer;
 }
 
+LZ4_stream_t* LZ4_createStream_advanced(LZ4_CustomMem cmem, int hashLog)
+{
+    int const stateSize = LZ4_sizeofState_advanced(hashLog);
+    void* buffer;
+    LZ4_stream_t* state;
+    if (stateSize == 0) return NULL;   /* invalid hashLog */
+    buffer = LZ4_customAlloc((size_t)stateSize, cmem);
+    DEBUGLOG(4, "LZ4_createStream_advanced %p (hashLog=%i)", buffer, hashLog);
+    if (buffer == NULL) return NULL;
+    state = LZ4_initStream_advanced(buffer, (size_t)stateSize, hashLog);
+    if (state == NULL) {   /* custom allocator returned insufficiently aligned memory */
+        LZ4_customFree(buffer, (size_t)stateSize, cmem);
+        return NULL;
+    }
+    return state;
+}
+
+void LZ4_freeStream_advanced(LZ4_stream_t* LZ4_stream, LZ4_CustomMem cmem, int hashLog)
+{
+    DEBUGLOG(5, "LZ4_freeStream_advanced %p", LZ4_stream);
+    LZ4_customFree(LZ4_stream, (size_t)LZ4_sizeofState_advanced(hashLog), cmem);
+}
+
+void LZ4_initArena(LZ4_arena_t* arena, void* buffer, size_t capacity)
+{
+    arena->buffer = (char*)buffer;
+    arena->capacity = (buffer == NULL) ? 0 : capacity;
+    arena->used = 0;
+}
+
+void* LZ4_arenaAlloc(void* arena, size_t size, size_t alignment, int numaNode)
+{
+    LZ4_arena_t* const a = (LZ4_arena_t*)arena;
+    size_t pad;
+    (void)numaNode;   /* placement is decided by the owner of the buffer */
+    assert((alignment & (alignment - 1)) == 0);   /* power of 2 */
+    if (a->buffer == NULL) return NULL;
+    pad = (alignment > 1) ? (size_t)(0 - (size_t)(a->buffer + a->used)) & (alignment - 1) : 0;
+    if (pad > a->capacity - a->used) return NULL;
+    if (size > a->capacity - a->used - pad) return NULL;
+    a->used += pad + size;
+    return a->buffer + (a->used - size);
+}
+
+int LZ4_sizeofState_advanced(int hashLog)
+{
+    if (hashLog == 0) return LZ4_sizeofState();
+    if ((hashLog < LZ4_STREAM_HASHLOG_MIN) || (hashLog > LZ4_STREAM_HASHLOG_MAX)) return 0;
+    return (int)LZ4_stream_sizeof((U32)hashLog);
+}
+
+LZ4_stream_t* LZ4_initStream_advanced(void* buffer, size_t size, int hashLog)
+{
+    int const stateSize = LZ4_sizeofState_advanced(hashLog);
+    DEBUGLOG(5, "LZ4_initStream_advanced (hashLog=%i)", hashLog);
+    if (buffer == NULL) { return NULL; }
+    if (stateSize == 0) { return NULL; }   /* invalid hashLog */
+    if (size < (size_t)stateSize) { return NULL; }
+    if (!LZ4_isAligned(buffer, LZ4_stream_t_alignment())) return NULL;
+    MEM_INIT(buffer, 0, (size_t)stateSize);
+    ((LZ4_stream_t*)buffer)->internal_donotuse.hashLog = (U32)hashLog;
+    return (LZ4_stream_t*)buffer;
+}
+
+/* LZ4_clearStream() :
+ * same as LZ4_resetStream(), but preserves the hash table size,
+ * so that it can be applied to states initialized with LZ4_initStream_advanced() */
+static void LZ4_clearStream(LZ4_stream_t_internal* cctx)
+{
+    U32 hashLog = cctx->hashLog;
+    if ((hashLog < LZ4_STREAM_HASHLOG_MIN) || (hashLog > LZ4_STREAM_HASHLOG_MAX)) hashLog = 0;
+    MEM_INIT(cctx, 0, hashLog ? LZ4_stream_sizeof(hashLog) : sizeof(LZ4_stream_t_internal));
+    cctx->hashLog = hashLog;
+}
+
 /* resetStream is now deprecated,
  * prefer initStream() which is more general */
 void LZ4_resetStream (LZ4_stream_t* LZ4_stream)
@@ -1592,6 +2230,7 @@ int LZ4_loadDict_internal(LZ4_stream_t* LZ4_dict,
     const tableType_t tableType = byU32;
     const BYTE* p = (const BYTE*)dictionary;
     const BYTE* const dictEnd = p + dictSize;
+    U32 hashLog;
     U32 idx32;
 
     DEBUGLOG(4, "LZ4_loadDict (%i bytes from %p into %p)", dictSize, dictionary, LZ4_dict);
@@ -1600,7 +2239,8 @@ int LZ4_loadDict_internal(LZ4_stream_t* LZ4_dict,
      * and not just continue it with prepareTable()
      * to avoid any risk of generating overflowing matchIndex
      * when compressing using this dictionary */
-    LZ4_resetStream(LZ4_dict);
+    LZ4_clearStream(dict);
+    hashLog = LZ4_stream_hashLog(dict);
 
     /* We always increment the offset by 64 KB, since, if the dict is longer,
      * we truncate it to the last 64k, and if it's shorter, we still want to
@@ -1621,7 +2261,7 @@ int LZ4_loadDict_internal(LZ4_stream_t* LZ4_dict,
     idx32 = dict->currentOffset - dict->dictSize;
 
     while (p <= dictEnd-HASH_UNIT) {
-        U32 const h = LZ4_hashPosition(p, tableType);
+        U32 const h = LZ4_hashPosition(p, tableType, hashLog);
         /* Note: overwriting => favors positions end of dictionary */
         LZ4_putIndexOnHash(idx32, h, dict->hashTable, tableType);
         p+=3; idx32+=3;
@@ -1632,7 +2272,7 @@ int LZ4_loadDict_internal(LZ4_stream_t* LZ4_dict,
         p = dict->dictionary;
         idx32 = dict->currentOffset - dict->dictSize;
         while (p <= dictEnd-HASH_UNIT) {
-            U32 const h = LZ4_hashPosition(p, tableType);
+            U32 const h = LZ4_hashPosition(p, tableType, hashLog);
             U32 const limit = dict->currentOffset - 64 KB;
             if (LZ4_getIndexOnHash(h, dict->hashTable, tableType) <= limit) {
                 /* Note: not overwriting => favors positions beginning of dictionary */
@@ -1684,6 +2324,58 @@ void LZ4_attach_dictionary(LZ4_stream_t* workingStream, const LZ4_stream_t* dict
 }
 
 
+/*-******************************
+*  Shared dictionary
+********************************/
+
+struct LZ4_CDict_s {
+    LZ4_stream_t stream;   /* loaded once, then only read; dictionary content follows this structure */
+};  /* typedef'd to LZ4_CDict within lz4.h */
+
+#if !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION)
+LZ4_CDict* LZ4_createCDict(const char* dictBuffer, int dictSize)
+{
+    LZ4_CDict* cdict;
+    char* content;
+    if (dictSize < 0 || (dictBuffer == NULL && dictSize > 0)) return NULL;
+    /* only the last 64 KB can be referenced */
+    if (dictSize > 64 KB) {
+        dictBuffer += dictSize - 64 KB;
+        dictSize = 64 KB;
+    }
+    /* single allocation : table and content stay close in memory */
+    cdict = (LZ4_CDict*)ALLOC(sizeof(LZ4_CDict) + (size_t)dictSize);   /* malloc-calloc always properly aligned */
+    DEBUGLOG(4, "LZ4_createCDict %p (dictSize=%i)", cdict, dictSize);
+    if (cdict == NULL) return NULL;
+    content = (char*)(cdict + 1);
+    if (dictSize) LZ4_memcpy(content, dictBuffer, (size_t)dictSize);
+    LZ4_initStream(&cdict->stream, sizeof(cdict->stream));
+    LZ4_loadDictSlow(&cdict->stream, content, dictSize);
+    return cdict;
+}
+
+void LZ4_freeCDict(LZ4_CDict* cdict)
+{
+    DEBUGLOG(4, "LZ4_freeCDict %p", cdict);
+    FREEMEM(cdict);   /* support free on NULL */
+}
+#endif
+
+void LZ4_attach_CDict(LZ4_stream_t* workingStream, const LZ4_CDict* cdict)
+{
+    LZ4_attach_dictionary(workingStream, (cdict == NULL) ? NULL : &cdict->stream);
+}
+
+int LZ4_compress_fast_usingCDict(void* state, const LZ4_CDict* cdict,
+                                 const char* src, char* dst, int srcSize, int dstCapacity,
+                                 int acceleration)
+{
+    LZ4_stream_t* const ctx = (LZ4_stream_t*)state;
+    LZ4_resetStream_fast(ctx);
+    LZ4_attach_CDict(ctx, cdict);
+    return LZ4_compress_fast_continue(ctx, src, dst, srcSize, dstCapacity, acceleration);
+}
+
 static void LZ4_renormDictT(LZ4_stream_t_internal* LZ4_dict, int nextSize)
 {
     assert(nextSize >= 0);
@@ -1691,11 +2383,13 @@ static void LZ4_renormDictT(LZ4_stream_t_internal* LZ4_dict, int nextSize)
         /* rescale hash table */
         U32 const delta = LZ4_dict->currentOffset - 64 KB;
         const BYTE* dictEnd = LZ4_dict->dictionary + LZ4_dict->dictSize;
+        U32* const hashTable = LZ4_dict->hashTable;   /* may be larger than declared array */
+        int const hashSize = 1 << LZ4_stream_hashLog(LZ4_dict);
         int i;
         DEBUGLOG(4, "LZ4_renormDictT");
-        for (i=0; i<LZ4_HASH_SIZE_U32; i++) {
-            if (LZ4_dict->hashTable[i] < delta) LZ4_dict->hashTable[i]=0;
-            else LZ4_dict->hashTable[i] -= delta;
+        for (i=0; i<hashSize; i++) {
+            if (hashTable[i] < delta) hashTable[i]=0;
+            else hashTable[i] -= delta;
         }
         LZ4_dict->currentOffset = 64 KB;
         if (LZ4_dict->dictSize > 64 KB) LZ4_dict->dictSize = 64 KB;
@@ -1711,10 +2405,20 @@ int LZ4_compress_fast_continue (LZ4_stream_t* LZ4_stream,
 {
     const tableType_t tableType = byU32;
     LZ4_stream_t_internal* const streamPtr = &LZ4_stream->internal_donotuse;
-    const char* dictEnd = streamPtr->dictSize ? (const char*)streamPtr->dictionary + streamPtr->dictSize : NULL;
+    const char* dictEnd;
 
     DEBUGLOG(5, "LZ4_compress_fast_continue (inputSize=%i, dictSize=%u)", inputSize, streamPtr->dictSize);
 
+    /* dictCtx tables can only be shared when they have the same size :
+     * otherwise, re-index the dictionary content into the working table */
+    if ( (streamPtr->dictCtx != NULL)
+      && (LZ4_stream_hashLog(streamPtr->dictCtx) != LZ4_stream_hashLog(streamPtr)) ) {
+        const LZ4_stream_t_internal* const dictCtx = streamPtr->dictCtx;
+        DEBUGLOG(5, "LZ4_compress_fast_continue: dictCtx hashLog differs => re-index dictionary");
+        LZ4_loadDict_internal(LZ4_stream, (const char*)dictCtx->dictionary, (int)dictCtx->dictSize, _ld_fast);
+    }
+    dictEnd = streamPtr->dictSize ? (const char*)streamPtr->dictionary + streamPtr->dictSize : NULL;
+
     LZ4_renormDictT(streamPtr, inputSize);   /* fix index overflow */
     if (acceleration < 1) acceleration = LZ4_ACCELERATION_DEFAULT;
     if (acceleration > LZ4_ACCELERATION_MAX) acceleration = LZ4_ACCELERATION_MAX;
@@ -1764,7 +2468,7 @@ int LZ4_compress_fast_continue (LZ4_stream_t* LZ4_stream,
                  * cost to copy the dictionary's tables into the active context,
                  * so that the compression loop is only looking into one table.
                  */
-                LZ4_memcpy(streamPtr, streamPtr->dictCtx, sizeof(*streamPtr));
+                LZ4_memcpy(streamPtr, streamPtr->dictCtx, LZ4_stream_sizeof(LZ4_stream_hashLog(streamPtr)));
                 result = LZ4_compress_generic(streamPtr, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, tableType, usingExtDict, noDictIssue, acceleration);
             } else {
                 result = LZ4_compress_generic(streamPtr, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, tableType, usingDictCtx, noDictIssue, acceleration);
@@ -2013,14 +2717,23 @@ read_variable_length(const BYTE** ip, const BYTE* ilimit,
     return length;
 }
 
-/*! LZ4_decompress_generic() :
+/* Hands decoded output over to a callback, in chunks of at least @interval bytes (except the last one) */
+typedef struct {
+    LZ4_checkpointFn fn;
+    void* opaque;
+    size_t interval;
+} LZ4_decCheckpoint_t;
+
+/*! LZ4_decompress_generic_checkpoints() :
  *  This generic decompression function covers all use cases.
  *  It shall be instantiated several times, using different sets of directives.
  *  Note that it is important for performance that this function really get inlined,
  *  in order to remove useless branches during compilation optimization.
+ *  @checkpoint is NULL for all instantiations but LZ4_decompress_safe_usingDict_withCheckpoints(),
+ *  in which case all related code is removed.
  */
 LZ4_FORCE_INLINE int
-LZ4_decompress_generic(
+LZ4_decompress_generic_checkpoints(
                  const char* const src,
                  char* const dst,
                  int srcSize,
@@ -2030,7 +2743,8 @@ LZ4_decompress_generic(
                  dict_directive dict,                 /* noDict, withPrefix64k, usingExtDict */
                  const BYTE* const lowPrefix,  /* always <= dst, == dst when no prefix */
                  const BYTE* const dictStart,  /* only if dict==usingExtDict */
-                 const size_t dictSize         /* note : = 0 if noDict */
+                 const size_t dictSize,        /* note : = 0 if noDict */
+                 const LZ4_decCheckpoint_t* const checkpoint
                  )
 {
     if ((src == NULL) || (outputSize < 0)) { return -1; }
@@ -2045,6 +2759,11 @@ LZ4_decompress_generic(
         const BYTE* const dictEnd = (dictStart == NULL) ? NULL : dictStart + dictSize;
 
         const int checkOffset = (dictSize < (int)(64 KB));
+        /* external dictionary outside of dst buffer : fixed-size copies from it can't overlap output */
+        const int dictDisjoint = (dict == usingExtDict) && ((dictEnd <= (const BYTE*)dst) || (dictStart >= oend));
+
+        const BYTE* cpStart = op;   /* decoded output not yet handed over to checkpoint */
+        const BYTE* cpNext = ((checkpoint != NULL) && (checkpoint->interval < (size_t)outputSize)) ? op + checkpoint->interval : oend;
 
 
         /* Set up the "end" pointers for the shortcut. */
@@ -2084,6 +2803,12 @@ LZ4_decompress_generic(
             /* Main fastloop assertion: We can always wildcopy FASTLOOP_SAFE_DISTANCE */
             assert(oend - op >= FASTLOOP_SAFE_DISTANCE);
             assert(ip < iend);
+            if ((checkpoint != NULL) && unlikely(op >= cpNext)) {
+                /* output before op is final, wild copies only write beyond it */
+                checkpoint->fn(checkpoint->opaque, (const char*)cpStart, (size_t)(op - cpStart));
+                cpStart = op;
+                cpNext = (checkpoint->interval < (size_t)(oend - op)) ? op + checkpoint->interval : oend;
+            }
             token = *ip++;
             length = token >> ML_BITS;  /* literal length */
             DEBUGLOG(7, "blockPos%6u: litLength token = %u", (unsigned)(op-(BYTE*)dst), (unsigned)length);
@@ -2176,7 +2901,12 @@ LZ4_decompress_generic(
 
                 if (length <= (size_t)(lowPrefix-match)) {
                     /* match fits entirely within external dictionary : just copy */
-                    LZ4_memmove(op, dictEnd - (lowPrefix-match), length);
+                    if ((length <= 32) && ((size_t)(lowPrefix-match) >= 32) && dictDisjoint) {
+                        /* short match, with 32 bytes to read in dictionary and to write before oend */
+                        LZ4_memcpy(op, dictEnd - (lowPrefix-match), 32);
+                    } else {
+                        LZ4_memmove(op, dictEnd - (lowPrefix-match), length);
+                    }
                     op += length;
                 } else {
                     /* match stretches into both external dictionary and current block */
@@ -2214,6 +2944,11 @@ LZ4_decompress_generic(
         DEBUGLOG(6, "using safe decode loop");
         while (1) {
             assert(ip < iend);
+            if ((checkpoint != NULL) && unlikely(op >= cpNext)) {
+                checkpoint->fn(checkpoint->opaque, (const char*)cpStart, (size_t)(op - cpStart));
+                cpStart = op;
+                cpNext = (checkpoint->interval < (size_t)(oend - op)) ? op + checkpoint->interval : oend;
+            }
             token = *ip++;
             length = token >> ML_BITS;  /* literal length */
             DEBUGLOG(7, "blockPos%6u: litLength token = %u", (unsigned)(op-(BYTE*)dst), (unsigned)length);
@@ -2435,6 +3170,9 @@ LZ4_decompress_generic(
         }
 
         /* end of decoding */
+        if ((checkpoint != NULL) && (op > cpStart)) {
+            checkpoint->fn(checkpoint->opaque, (const char*)cpStart, (size_t)(op - cpStart));
+        }
         DEBUGLOG(5, "decoded %i bytes", (int) (((char*)op)-dst));
         return (int) (((char*)op)-dst);     /* Nb of output bytes decoded */
 
@@ -2444,6 +3182,23 @@ LZ4_decompress_generic(
     }
 }
 
+LZ4_FORCE_INLINE int
+LZ4_decompress_generic(
+                 const char* const src,
+                 char* const dst,
+                 int srcSize,
+                 int outputSize,
+                 earlyEnd_directive partialDecoding,
+                 dict_directive dict,
+                 const BYTE* const lowPrefix,
+                 const BYTE* const dictStart,
+                 const size_t dictSize)
+{
+    return LZ4_decompress_generic_checkpoints(src, dst, srcSize, outputSize,
+                                              partialDecoding, dict, lowPrefix, dictStart, dictSize,
+                                              NULL);
+}
+
 
 /*===== Instantiate the API decoding functions. =====*/
 
@@ -2541,6 +3296,27 @@ int LZ4_decompress_safe_partial_forceExtDict(const char* source, char* dest,
                                   (BYTE*)dest, (const BYTE*)dictStart, dictSize);
 }
 
+/* External dictionary of at least 64 KB : only its last 64 KB can be referenced,
+ * so the offset check is statically removed, leaving only the dictionary boundary check. */
+LZ4_FORCE_O2
+static int LZ4_decompress_safe_extDict64k(const char* source, char* dest, int compressedSize, int maxOutputSize,
+                                          const void* dictEnd)
+{
+    return LZ4_decompress_generic(source, dest, compressedSize, maxOutputSize,
+                                  decode_full_block, usingExtDict,
+                                  (BYTE*)dest, (const BYTE*)dictEnd - 64 KB, 64 KB);
+}
+
+LZ4_FORCE_O2
+static int LZ4_decompress_safe_partial_extDict64k(const char* source, char* dest, int compressedSize, int targetOutputSize, int dstCapacity,
+                                          const void* dictEnd)
+{
+    dstCapacity = MIN(targetOutputSize, dstCapacity);
+    return LZ4_decompress_generic(source, dest, compressedSize, dstCapacity,
+                                  partial_decode, usingExtDict,
+                                  (BYTE*)dest, (const BYTE*)dictEnd - 64 KB, 64 KB);
+}
+
 LZ4_FORCE_O2
 static int LZ4_decompress_fast_extDict(const char* source, char* dest, int originalSize,
                                        const void* dictStart, size_t dictSize)
@@ -2552,10 +3328,10 @@ static int LZ4_decompress_fast_extDict(const char* source, char* dest, int origi
 
 /* The "double dictionary" mode, for use with e.g. ring buffers: the first part
  * of the dictionary is passed as prefix, and the second via dictStart + dictSize.
- * These routines are used only once, in LZ4_decompress_*_continue().
+ * Used by LZ4_decompress_safe_continue() and LZ4_decompress_safe_usingSplitDict().
  */
-LZ4_FORCE_INLINE
-int LZ4_decompress_safe_doubleDict(const char* source, char* dest, int compressedSize, int maxOutputSize,
+LZ4_FORCE_O2
+static int LZ4_decompress_safe_doubleDict(const char* source, char* dest, int compressedSize, int maxOutputSize,
                                    size_t prefixSize, const void* dictStart, size_t dictSize)
 {
     return LZ4_decompress_generic(source, dest, compressedSize, maxOutputSize,
@@ -2563,6 +3339,623 @@ int LZ4_decompress_safe_doubleDict(const char* source, char* dest, int compresse
                                   (BYTE*)dest-prefixSize, (const BYTE*)dictStart, dictSize);
 }
 
+
+/*===== Resumable block decoder =====*/
+
+/* Copies one validated sequence using fixed-size and wild copies.
+ * Requires ll+ml+32 bytes of room after @op, and ll+16 bytes readable from @lit.
+ * @return : position after the sequence */
+LZ4_FORCE_INLINE BYTE*
+LZ4_copySequence_wild(BYTE* op, const BYTE* const lit, size_t ll, size_t ml, size_t offset)
+{
+    BYTE* const cpy = op + ll + ml;
+    const BYTE* match;
+    assert(ml >= MINMATCH);
+    if (ll <= 16) {
+        LZ4_memcpy(op, lit, 16);
+    } else {
+        LZ4_wildCopyLong(op, lit, op+ll);
+    }
+    op += ll;
+    match = op - offset;
+    if (likely(offset >= 16)) {
+        LZ4_memcpy(op, match, 16);
+        LZ4_memcpy(op+16, match+16, 16);
+        if (unlikely(ml > 32)) LZ4_wildCopyLong(op+32, match+32, cpy);
+    } else if (offset >= 8) {
+        LZ4_memcpy(op, match, 8);
+        LZ4_wildCopy8(op+8, match+8, cpy);
+    } else {
+        op[0] = match[0];
+        op[1] = match[1];
+        op[2] = match[2];
+        op[3] = match[3];
+        match += inc32table[offset];
+        LZ4_memcpy(op+4, match, 4);
+        match -= dec64table[offset];
+        if (ml > 8) LZ4_wildCopy8(op+8, match, cpy);
+    }
+    return cpy;
+}
+
+/* Copies @n bytes of a match at @offset, which may start within the external dictionary.
+ * Overlapping matches are copied by doubling chunks : source and destination never overlap within a chunk. */
+static void LZ4_blockDecoder_copyMatch(BYTE* op, size_t offset, size_t n,
+                                       const BYTE* const lowPrefix, const BYTE* const dictEnd)
+{
+    size_t const inPrefix = (size_t)(op - lowPrefix);
+    const BYTE* match;
+    assert(offset > 0);
+    if (offset > inPrefix) {
+        size_t const back = offset - inPrefix;
+        size_t const c = MIN(back, n);
+        assert(dictEnd != NULL);
+        LZ4_memmove(op, dictEnd - back, c);
+        op += c;
+        n -= c;
+    }
+    match = op - offset;
+    while (n) {
+        size_t const c = MIN(n, (size_t)(op - match));
+        LZ4_memcpy(op, match, c);
+        op += c;
+        n -= c;
+    }
+}
+
+/* Decodes whole sequences, as long as they are far from buffer ends, fit within step budget,
+ * and reference only the prefix. Stops before the first sequence which doesn't,
+ * leaving it to the exact path, which also detects malformed input. */
+LZ4_FORCE_INLINE void
+LZ4_blockDecoder_fastSequences(const BYTE** ipPtr, BYTE** opPtr,
+                               const BYTE* const iend, BYTE* const olimit,
+                               const BYTE* const lowPrefix)
+{
+    const BYTE* ip = *ipPtr;
+    BYTE* op = *opPtr;
+    while (((size_t)(olimit-op) >= 64) && ((size_t)(iend-ip) >= 32)) {
+        const BYTE* p = ip;
+        unsigned const token = *p++;
+        size_t ll = token >> ML_BITS;
+        size_t ml = token & ML_MASK;
+        size_t offset;
+        const BYTE* lit;
+        if (ll == RUN_MASK) {
+            size_t const addl = read_variable_length(&p, iend-RUN_MASK, 1);
+            if (addl == rvl_error) break;
+            ll += addl;
+        }
+        if ((ll + 32 > (size_t)(iend-p)) || (ll + 64 > (size_t)(olimit-op))) break;
+        lit = p;
+        p += ll;
+        offset = LZ4_readLE16(p);
+        p += 2;
+        if (ml == ML_MASK) {
+            size_t const addl = read_variable_length(&p, iend - LASTLITERALS + 1, 0);
+            if (addl == rvl_error) break;
+            ml += addl;
+        }
+        ml += MINMATCH;
+        if ((offset == 0) || (offset > (size_t)(op + ll - lowPrefix))) break;
+        if (ll + ml + 32 > (size_t)(olimit-op)) break;
+        op = LZ4_copySequence_wild(op, lit, ll, ml, offset);
+        ip = p;
+    }
+    *ipPtr = ip;
+    *opPtr = op;
+}
+
+int LZ4_initBlockDecoder(LZ4_blockDecoder_t* bd,
+                         const char* src, int srcSize, char* dst, int dstCapacity,
+                         LZ4_streamDecode_t* history)
+{
+    DEBUGLOG(5, "LZ4_initBlockDecoder (srcSize:%i, dstSize:%i)", srcSize, dstCapacity);
+    if (bd == NULL) return -1;
+    MEM_INIT(bd, 0, sizeof(*bd));
+    bd->status = -1;
+    if ((src == NULL) || (srcSize <= 0) || (dstCapacity < 0)) return -1;
+    if ((dst == NULL) && (dstCapacity > 0)) return -1;
+    bd->ip = src;
+    bd->iend = src + srcSize;
+    bd->op = bd->ostart = dst;
+    bd->oend = dst + dstCapacity;
+    bd->lowPrefix = dst;
+    bd->history = history;
+    if (history != NULL) {
+        LZ4_streamDecode_t_internal* const lz4sd = &history->internal_donotuse;
+        if (lz4sd->prefixSize == 0) {
+            assert(lz4sd->extDictSize == 0);
+        } else if (lz4sd->prefixEnd == (const BYTE*)dst) {
+            /* rolling the current segment : prefix, and eventually an older external dictionary */
+            bd->lowPrefix = dst - lz4sd->prefixSize;
+            if (lz4sd->extDictSize) {
+                bd->dictEnd = (const char*)lz4sd->externalDict + lz4sd->extDictSize;
+                bd->dictSize = lz4sd->extDictSize;
+            }
+        } else {
+            /* switching to another buffer : previous prefix becomes the external dictionary */
+            bd->dictEnd = (const char*)lz4sd->prefixEnd;
+            bd->dictSize = lz4sd->prefixSize;
+    }   }
+    if (dstCapacity == 0) {
+        bd->status = ((srcSize==1) && (*src==0)) ? 0 : -1;
+        return bd->status;
+    }
+    bd->status = 1;
+    return 0;
+}
+
+/* Applies the same history update as LZ4_decompress_safe_continue() */
+static void LZ4_blockDecoder_updateHistory(LZ4_blockDecoder_t* bd)
+{
+    LZ4_streamDecode_t_internal* const lz4sd = &bd->history->internal_donotuse;
+    size_t const dSize = (size_t)(bd->op - bd->ostart);
+    if (dSize == 0) return;
+    if (lz4sd->prefixSize == 0) {
+        lz4sd->prefixSize = dSize;
+        lz4sd->prefixEnd = (BYTE*)bd->op;
+    } else if (lz4sd->prefixEnd == (const BYTE*)bd->ostart) {
+        lz4sd->prefixSize += dSize;
+        lz4sd->prefixEnd += dSize;
+    } else {
+        lz4sd->extDictSize = lz4sd->prefixSize;
+        lz4sd->externalDict = lz4sd->prefixEnd - lz4sd->extDictSize;
+        lz4sd->prefixSize = dSize;
+        lz4sd->prefixEnd = (BYTE*)bd->op;
+    }
+}
+
+int LZ4_decompress_safe_step(LZ4_blockDecoder_t* bd, int maxOutputSize)
+{
+    const BYTE* ip;
+    const BYTE* const iend = (const BYTE*)bd->iend;
+    BYTE* op;
+    BYTE* const oend = (BYTE*)bd->oend;
+    BYTE* olimit;
+    const BYTE* const lowPrefix = (const BYTE*)bd->lowPrefix;
+    const BYTE* const dictEnd = (const BYTE*)bd->dictEnd;
+    size_t const dictSize = bd->dictSize;
+    const BYTE* lit = (const BYTE*)bd->lit;
+    size_t litRemaining = bd->litRemaining;
+    size_t matchRemaining = bd->matchRemaining;
+    size_t offset = bd->offset;
+
+    if (bd->status <= 0) return bd->status;
+    if (maxOutputSize <= 0) return -1;
+    ip = (const BYTE*)bd->ip;
+    op = (BYTE*)bd->op;
+    olimit = op + MIN((size_t)(oend - op), (size_t)maxOutputSize);
+
+    for (;;) {
+        unsigned token;
+        size_t ll, ml;
+
+        /* resume pending literals, then pending match */
+        if (litRemaining) {
+            size_t const n = MIN(litRemaining, (size_t)(olimit - op));
+            LZ4_memcpy(op, lit, n);
+            op += n;
+            lit += n;
+            litRemaining -= n;
+            if (litRemaining) break;   /* suspended */
+        }
+        if (matchRemaining) {
+            size_t const n = MIN(matchRemaining, (size_t)(olimit - op));
+            LZ4_blockDecoder_copyMatch(op, offset, n, lowPrefix, dictEnd);
+            op += n;
+            matchRemaining -= n;
+            if (matchRemaining) break;   /* suspended */
+        }
+        if (ip == iend) { bd->status = 0; break; }   /* last literals copied */
+        LZ4_blockDecoder_fastSequences(&ip, &op, iend, olimit, lowPrefix);
+        /* a full output buffer still parses next token, to detect end of block or corruption */
+        if ((op == olimit) && (olimit != oend)) break;
+
+        /* next sequence */
+        token = *ip++;
+        ll = token >> ML_BITS;
+        if (ll == RUN_MASK) {
+            size_t const addl = read_variable_length(&ip, iend-RUN_MASK, 1);
+            if (addl == rvl_error) goto _output_error;
+            ll += addl;
+        }
+        if ((ll + MFLIMIT > (size_t)(oend-op)) || (ll + 2+1+LASTLITERALS > (size_t)(iend-ip))) {
+            /* last sequence : literals only, ending exactly at end of input */
+            if ((ll != (size_t)(iend-ip)) || (ll > (size_t)(oend-op))) goto _output_error;
+            lit = ip;
+            litRemaining = ll;
+            ip = iend;
+            continue;
+        }
+        lit = ip;
+        ip += ll;
+        offset = LZ4_readLE16(ip);
+        ip += 2;
+        ml = token & ML_MASK;
+        if (ml == ML_MASK) {
+            size_t const addl = read_variable_length(&ip, iend - LASTLITERALS + 1, 0);
+            if (addl == rvl_error) goto _output_error;
+            ml += addl;
+        }
+        ml += MINMATCH;
+        if ((offset == 0) || (offset > (size_t)(op + ll - lowPrefix) + dictSize)) goto _output_error;   /* offset outside buffers */
+        if (ml + LASTLITERALS > (size_t)(oend-op) - ll) goto _output_error;   /* last LASTLITERALS bytes must be literals */
+
+        if ( (ll + ml <= (size_t)(olimit-op))
+          && (ll + ml + 32 <= (size_t)(oend-op))
+          && (offset <= (size_t)(op + ll - lowPrefix))
+          && (ll + 16 <= (size_t)(iend-lit)) ) {
+            /* whole sequence within step budget, far from buffer ends, no external dictionary */
+            op = LZ4_copySequence_wild(op, lit, ll, ml, offset);
+            continue;
+        }
+        litRemaining = ll;
+        matchRemaining = ml;
+    }
+
+    bd->ip = (const char*)ip;
+    bd->op = (char*)op;
+    bd->lit = (const char*)lit;
+    bd->litRemaining = litRemaining;
+    bd->matchRemaining = matchRemaining;
+    bd->offset = offset;
+    if ((bd->status == 0) && (bd->history != NULL)) LZ4_blockDecoder_updateHistory(bd);
+    return bd->status;
+
+_output_error:
+    bd->status = -1;
+    return -1;
+}
+
+int LZ4_blockDecoder_decodedSize(const LZ4_blockDecoder_t* bd)
+{
+    return (int)(bd->op - bd->ostart);
+}
+
+/*===== Range decoder =====*/
+
+/* LZ4_parseSequences() parses a batch of sequences into LZ4_seqDesc_t,
+ * validating all of them (input and output bounds, offsets, end-of-block rules),
+ * so that callers can then walk through sequences of the batch without further checks.
+ */
+typedef struct {
+    U32 litPos;     /* position of literals, relative to src */
+    U32 litLen;
+    U32 offset;
+    U32 matchLen;   /* 0 for last sequence of the block (literals only) */
+} LZ4_seqDesc_t;
+
+#define LZ4_SEQ_BATCH 64   /* 1 KB on stack */
+
+/* @return : nb of sequences parsed into @seqs (<= LZ4_SEQ_BATCH), or -1 if input is malformed.
+ *           *blockEnd is set when last sequence of the block has been parsed. */
+LZ4_FORCE_INLINE int
+LZ4_parseSequences(const BYTE* const istart, const BYTE** ipPtr, const BYTE* const iend,
+                   size_t* opPosPtr, size_t const dstCapacity,
+                   LZ4_seqDesc_t* seqs, int* blockEnd)
+{
+    const BYTE* ip = *ipPtr;
+    size_t opPos = *opPosPtr;
+    /* shortcut limits : a sequence with short literals (<= 14) and short match (<= 18)
+     * starting before them can't be the last one, nor violate any end-of-block rule */
+    const BYTE* const ishort = (iend - istart > 14+2+LASTLITERALS+1) ? iend - (14+2+LASTLITERALS+1) : istart;
+    size_t const oshort = (dstCapacity > 14+18+LASTLITERALS) ? dstCapacity - (14+18+LASTLITERALS) : 0;
+    int n;
+
+    for (n = 0; n < LZ4_SEQ_BATCH; n++) {
+        unsigned const token = *ip++;
+        size_t ll = token >> ML_BITS;
+        size_t ml = token & ML_MASK;
+        size_t offset;
+        assert(ip <= iend);
+
+        if ( (ll != RUN_MASK) & (ml != ML_MASK)
+          && likely((ip < ishort) & (opPos < oshort)) ) {
+            seqs[n].litPos = (U32)(ip - istart);
+            seqs[n].litLen = (U32)ll;
+            ip += ll;
+            opPos += ll;
+            offset = LZ4_readLE16(ip); ip += 2;
+            if (unlikely(offset - 1 >= opPos)) goto _parse_error;   /* offset == 0, or beyond start of dst */
+            seqs[n].offset = (U32)offset;
+            seqs[n].matchLen = (U32)(ml + MINMATCH);
+            opPos += ml + MINMATCH;
+            continue;
+        }
+
+        if (ll == RUN_MASK) {
+            size_t const addl = read_variable_length(&ip, iend-RUN_MASK, 1);
+            if (addl == rvl_error) goto _parse_error;
+            ll += addl;
+        }
+        if ((ll > (size_t)(iend-ip)) || (ll > dstCapacity - opPos)) goto _parse_error;
+        seqs[n].litPos = (U32)(ip - istart);
+        seqs[n].litLen = (U32)ll;
+        ip += ll;
+        opPos += ll;
+
+        if (ip == iend) {   /* last literals */
+            seqs[n].offset = 0;
+            seqs[n].matchLen = 0;
+            *blockEnd = 1;
+            n++;
+            break;
+        }
+        /* not the last sequence : same parsing restrictions as LZ4_decompress_generic() */
+        if ((dstCapacity - opPos < MFLIMIT) || ((size_t)(iend-ip) < 2+1+LASTLITERALS)) goto _parse_error;
+
+        offset = LZ4_readLE16(ip); ip += 2;
+        if (offset - 1 >= opPos) goto _parse_error;   /* no dictionary : match must start within dst */
+
+        if (ml == ML_MASK) {
+            size_t const addl = read_variable_length(&ip, iend - LASTLITERALS + 1, 0);
+            if (addl == rvl_error) goto _parse_error;
+            ml += addl;
+        }
+        ml += MINMATCH;
+        /* last LASTLITERALS bytes must be literals */
+        if (ml > dstCapacity - opPos - LASTLITERALS) goto _parse_error;
+        seqs[n].offset = (U32)offset;
+        seqs[n].matchLen = (U32)ml;
+        opPos += ml;
+        assert(ip < iend);
+    }
+
+    *ipPtr = ip;
+    *opPosPtr = opPos;
+    return n;
+
+_parse_error:
+    *ipPtr = ip;
+    return -1;
+}
+
+/* Range index layout (all fields little-endian) :
+ * - header : nbCheckpoints, decodedSize, compressedSize, maxSpan, indexSize (U32 each)
+ * - nbCheckpoints entries : srcPos, dstPos, historyPos (U32 each)
+ * - histories : one per checkpoint, from its historyPos up to next one's (or indexSize).
+ *   Each is a list of runs { distance (U16), length (U16), bytes[length] }, distance being counted back from the checkpoint,
+ *   covering all bytes before the checkpoint referenced by sequences starting in its segment. */
+#define LZ4_RIX_HEADERSIZE 20
+#define LZ4_RIX_ENTRYSIZE  12
+#define LZ4_RIX_RUNHEADER   4
+#define LZ4_RIX_WINDOW     (64 KB)
+
+/* @return : position of the token following the (not last) sequence @seq */
+static size_t LZ4_rix_nextToken(const LZ4_seqDesc_t* seq)
+{
+    size_t const extra = seq->matchLen - MINMATCH;
+    return (size_t)seq->litPos + seq->litLen + 2 + ((extra >= ML_MASK) ? (extra - ML_MASK) / 255 + 1 : 0);
+}
+
+/* Writes the history of the segment starting at @segStart, and clears @window.
+ * Only bits within [@wLow, @wHigh) can be set.
+ * @return : size of history, written at @dst unless it's NULL */
+static size_t LZ4_rix_flushHistory(BYTE* dst, U32* window, size_t wLow, size_t wHigh,
+                                   size_t segStart, const BYTE* decoded)
+{
+    size_t const wStart = segStart - LZ4_RIX_WINDOW;   /* position of bit 0; may wrap, positions are compared as offsets */
+    size_t hSize = 0;
+    size_t i = wLow;
+    if (wLow >= wHigh) return 0;
+    while (i < wHigh) {
+        size_t pos, end;
+        if (window[i/32] == 0) { i = (i | 31) + 1; continue; }
+        if (!(window[i/32] & (1U << (i%32)))) { i++; continue; }
+        pos = wStart + i;
+        end = i;
+        for (;;) {   /* extend run, absorbing gaps shorter than a run header */
+            size_t gap = 0;
+            while ((end < wHigh) && (window[end/32] & (1U << (end%32)))) end++;
+            while ((end + gap < wHigh) && (gap <= LZ4_RIX_RUNHEADER) && !(window[(end+gap)/32] & (1U << ((end+gap)%32)))) gap++;
+            if ((gap > LZ4_RIX_RUNHEADER) || (end + gap == wHigh)) break;
+            end += gap;
+        }
+        assert(end - i <= 65535);   /* bit 0 is never set */
+        if (dst != NULL) {
+            LZ4_writeLE16(dst + hSize, (U16)(LZ4_RIX_WINDOW - i));
+            LZ4_writeLE16(dst + hSize + 2, (U16)(end - i));
+            LZ4_memcpy(dst + hSize + LZ4_RIX_RUNHEADER, decoded + pos, end - i);
+        }
+        hSize += LZ4_RIX_RUNHEADER + (end - i);
+        i = end;
+    }
+    MEM_INIT(window + wLow/32, 0, ((wHigh-1)/32 - wLow/32 + 1) * sizeof(U32));
+    return hSize;
+}
+
+/* One scan of the block. The first pass (@window == NULL) counts checkpoints and measures segments,
+ * the second one writes the index, or only measures its size when @index is NULL.
+ * @return : nb of checkpoints (first pass) or index size (second pass), or -1 if @src is malformed */
+static int LZ4_rix_scan(const BYTE* const src, size_t srcSize, const BYTE* decoded, size_t decodedSize,
+                        size_t interval, U32* window, BYTE* index, size_t nbCheckpoints, size_t* maxSpanPtr)
+{
+    const BYTE* ip = src;
+    size_t opPos = 0;
+    size_t tokenPos = 0;
+    size_t segStart = 0;
+    size_t nbCp = 1;
+    size_t maxSpan = 0;
+    size_t wLow = LZ4_RIX_WINDOW, wHigh = 0;   /* bits set in window */
+    size_t hPos = LZ4_RIX_HEADERSIZE + nbCheckpoints * LZ4_RIX_ENTRYSIZE;
+    int blockEnd = 0;
+    LZ4_seqDesc_t seqs[LZ4_SEQ_BATCH];
+
+    if (window != NULL && index != NULL) {
+        LZ4_writeLE32(index + LZ4_RIX_HEADERSIZE, 0);
+        LZ4_writeLE32(index + LZ4_RIX_HEADERSIZE + 4, 0);
+        LZ4_writeLE32(index + LZ4_RIX_HEADERSIZE + 8, (U32)hPos);
+    }
+    while (!blockEnd) {
+        size_t const batchStart = opPos;
+        int const nbSeqs = LZ4_parseSequences(src, &ip, src + srcSize, &opPos, decodedSize, seqs, &blockEnd);
+        size_t o = batchStart;
+        int n;
+        if (nbSeqs < 0) return -1;
+        for (n = 0; n < nbSeqs; n++) {
+            if (o - segStart >= interval) {   /* new checkpoint, at this sequence */
+                if (o - segStart > maxSpan) maxSpan = o - segStart;
+                if (window != NULL) {
+                    hPos += LZ4_rix_flushHistory(index ? index + hPos : NULL, window, wLow, wHigh, segStart, decoded);
+                    wLow = LZ4_RIX_WINDOW; wHigh = 0;
+                    if (index != NULL) {
+                        BYTE* const entry = index + LZ4_RIX_HEADERSIZE + nbCp * LZ4_RIX_ENTRYSIZE;
+                        assert(nbCp < nbCheckpoints);
+                        LZ4_writeLE32(entry, (U32)tokenPos);
+                        LZ4_writeLE32(entry + 4, (U32)o);
+                        LZ4_writeLE32(entry + 8, (U32)hPos);
+                }   }
+                segStart = o;
+                nbCp++;
+            }
+            o += seqs[n].litLen;
+            if (seqs[n].matchLen == 0) break;   /* last literals */
+            if (window != NULL && o - seqs[n].offset < segStart) {
+                /* match starts before the checkpoint : its bytes up to the checkpoint are needed history */
+                size_t const wStart = segStart - LZ4_RIX_WINDOW;
+                size_t const mEnd = MIN(o - seqs[n].offset + seqs[n].matchLen, segStart);
+                size_t i;
+                if (o - seqs[n].offset - wStart < wLow) wLow = o - seqs[n].offset - wStart;
+                if (mEnd - wStart > wHigh) wHigh = mEnd - wStart;
+                for (i = o - seqs[n].offset - wStart; i < mEnd - wStart; i++) window[i/32] |= 1U << (i%32);
+            }
+            o += seqs[n].matchLen;
+            tokenPos = LZ4_rix_nextToken(seqs + n);
+        }
+        assert(o == opPos);
+        assert(blockEnd || tokenPos == (size_t)(ip - src));
+    }
+    if ((opPos != decodedSize) || (ip != src + srcSize)) return -1;
+    if (opPos - segStart > maxSpan) maxSpan = opPos - segStart;
+    if (maxSpanPtr) *maxSpanPtr = maxSpan;
+    if (window == NULL) return (int)nbCp;
+    assert(nbCp == nbCheckpoints);
+    hPos += LZ4_rix_flushHistory(index ? index + hPos : NULL, window, wLow, wHigh, segStart, decoded);
+    if (hPos > LZ4_MAX_INPUT_SIZE) return -1;
+    return (int)hPos;
+}
+
+int LZ4_buildRangeIndex(const char* src, int srcSize, const char* decoded, int decodedSize,
+                        int interval, void* index, int indexCapacity)
+{
+    U32 window[LZ4_RIX_WINDOW / 32];
+    size_t maxSpan = 0;
+    int nbCheckpoints, indexSize;
+    DEBUGLOG(5, "LZ4_buildRangeIndex (srcSize=%i, decodedSize=%i, interval=%i)", srcSize, decodedSize, interval);
+    if ((src == NULL) || (srcSize <= 0) || (decoded == NULL && decodedSize != 0) || (decodedSize < 0)) return -1;
+    if (interval < 1) interval = 1;
+
+    /* three scans : count checkpoints, measure index, write it */
+    nbCheckpoints = LZ4_rix_scan((const BYTE*)src, (size_t)srcSize, (const BYTE*)decoded, (size_t)decodedSize,
+                                 (size_t)interval, NULL, NULL, 0, &maxSpan);
+    if (nbCheckpoints < 0) return -1;
+    MEM_INIT(window, 0, sizeof(window));
+    indexSize = LZ4_rix_scan((const BYTE*)src, (size_t)srcSize, (const BYTE*)decoded, (size_t)decodedSize,
+                             (size_t)interval, window, NULL, (size_t)nbCheckpoints, NULL);
+    if (indexSize < 0) return -1;
+    if (index == NULL) return indexSize;
+    if (indexSize > indexCapacity) return -1;
+    if (LZ4_rix_scan((const BYTE*)src, (size_t)srcSize, (const BYTE*)decoded, (size_t)decodedSize,
+                     (size_t)interval, window, (BYTE*)index, (size_t)nbCheckpoints, NULL) != indexSize) return -1;
+    {   BYTE* const h = (BYTE*)index;
+        LZ4_writeLE32(h, (U32)nbCheckpoints);
+        LZ4_writeLE32(h + 4, (U32)decodedSize);
+        LZ4_writeLE32(h + 8, (U32)srcSize);
+        LZ4_writeLE32(h + 12, (U32)maxSpan);
+        LZ4_writeLE32(h + 16, (U32)indexSize);
+    }
+    return indexSize;
+}
+
+/* @return : nb of checkpoints of a well-formed @index, or 0 */
+static U32 LZ4_rix_check(const BYTE* index, size_t indexSize)
+{
+    U32 nbCheckpoints;
+    if ((index == NULL) || (indexSize < LZ4_RIX_HEADERSIZE + LZ4_RIX_ENTRYSIZE)) return 0;
+    nbCheckpoints = LZ4_readLE32(index);
+    if (LZ4_readLE32(index + 16) != indexSize) return 0;
+    if ((nbCheckpoints == 0) || (nbCheckpoints > (indexSize - LZ4_RIX_HEADERSIZE) / LZ4_RIX_ENTRYSIZE)) return 0;
+    if (LZ4_readLE32(index + 12) > LZ4_MAX_INPUT_SIZE) return 0;
+    return nbCheckpoints;
+}
+
+int LZ4_decompress_range_workspaceSize(const void* index, int indexSize, int rangeSize)
+{
+    const BYTE* const h = (const BYTE*)index;
+    size_t wksp;
+    if ((indexSize < 0) || (rangeSize < 0) || (LZ4_rix_check(h, (size_t)indexSize) == 0)) return -1;
+    wksp = LZ4_RIX_WINDOW + (size_t)LZ4_readLE32(h + 12) + (size_t)rangeSize;
+    if (wksp > LZ4_MAX_INPUT_SIZE) return -1;
+    return (int)wksp;
+}
+
+int LZ4_decompress_safe_range(const char* src, int srcSize, const void* index, int indexSize,
+                              char* dst, int rangeStart, int rangeSize,
+                              void* workspace, int workspaceSize)
+{
+    const BYTE* const h = (const BYTE*)index;
+    BYTE* const wksp = (BYTE*)workspace;
+    U32 const nbCheckpoints = LZ4_rix_check(h, (indexSize > 0) ? (size_t)indexSize : 0);
+    const BYTE* const entries = h + LZ4_RIX_HEADERSIZE;
+    size_t const rangeEnd = (size_t)rangeStart + (size_t)rangeSize;
+    size_t lo, hi, q;
+    size_t cpSrc, cpDst, base, prefixSize;
+
+    DEBUGLOG(5, "LZ4_decompress_safe_range (rangeStart=%i, rangeSize=%i)", rangeStart, rangeSize);
+    if (nbCheckpoints == 0) return -1;
+    if ((src == NULL) || (srcSize < 0) || ((U32)srcSize != LZ4_readLE32(h + 8))) return -1;
+    if ((rangeStart < 0) || (rangeSize < 0) || (rangeEnd > LZ4_readLE32(h + 4))) return -1;
+    if (rangeSize == 0) return 0;
+    if ((dst == NULL) || (wksp == NULL) || (workspaceSize < 0)) return -1;
+
+    /* last checkpoint at or before rangeStart */
+    lo = 0; hi = nbCheckpoints;
+    while (hi - lo > 1) {
+        size_t const mid = (lo + hi) / 2;
+        if (LZ4_readLE32(entries + mid * LZ4_RIX_ENTRYSIZE + 4) <= (U32)rangeStart) lo = mid; else hi = mid;
+    }
+    cpSrc = LZ4_readLE32(entries + lo * LZ4_RIX_ENTRYSIZE);
+    cpDst = LZ4_readLE32(entries + lo * LZ4_RIX_ENTRYSIZE + 4);
+    if ((cpSrc >= (size_t)srcSize) || (cpDst > (size_t)rangeStart)) return -1;
+    base = (cpDst > LZ4_RIX_WINDOW) ? cpDst - LZ4_RIX_WINDOW : 0;
+    prefixSize = cpDst - base;
+    if (prefixSize + (rangeEnd - cpDst) > (size_t)workspaceSize) return -1;
+
+    /* restore the history needed by all segments overlapping the range */
+    for (q = lo; q < nbCheckpoints; q++) {
+        const BYTE* const entry = entries + q * LZ4_RIX_ENTRYSIZE;
+        size_t const hStart = LZ4_readLE32(entry + 8);
+        size_t const hEnd = (q+1 < nbCheckpoints) ? LZ4_readLE32(entry + LZ4_RIX_ENTRYSIZE + 8) : (size_t)indexSize;
+        size_t const cpq = LZ4_readLE32(entry + 4);
+        size_t r = hStart;
+        if ((q > lo) && (cpq >= rangeEnd)) break;
+        if ((hStart > hEnd) || (hEnd > (size_t)indexSize)) return -1;
+        while (r < hEnd) {
+            size_t dist, pos, len;
+            if (hEnd - r < LZ4_RIX_RUNHEADER) return -1;
+            dist = LZ4_readLE16(h + r);
+            len = LZ4_readLE16(h + r + 2);
+            if (dist > cpq) return -1;
+            pos = cpq - dist;
+            r += LZ4_RIX_RUNHEADER;
+            if (len > hEnd - r) return -1;
+            /* bytes from cpDst onwards are decoded below */
+            if ((pos >= base) && (pos < cpDst)) {
+                size_t const n = MIN(len, cpDst - pos);
+                LZ4_memcpy(wksp + (pos - base), h + r, n);
+            }
+            r += len;
+    }   }
+
+    {   int const dSize = LZ4_decompress_generic(src + cpSrc, (char*)wksp + prefixSize,
+                                (int)((size_t)srcSize - cpSrc), (int)(rangeEnd - cpDst),
+                                partial_decode, noDict, wksp, NULL, 0);
+        if (dSize != (int)(rangeEnd - cpDst)) return -1;
+    }
+    LZ4_memcpy(dst, wksp + prefixSize + ((size_t)rangeStart - cpDst), (size_t)rangeSize);
+    return rangeSize;
+}
+
 /*===== streaming decompression functions =====*/
 
 #if !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION)
@@ -2657,8 +4050,12 @@ int LZ4_decompress_safe_continue (LZ4_streamDecode_t* LZ4_streamDecode, const ch
         /* The buffer wraps around, or they're switching to another buffer. */
         lz4sd->extDictSize = lz4sd->prefixSize;
         lz4sd->externalDict = lz4sd->prefixEnd - lz4sd->extDictSize;
-        result = LZ4_decompress_safe_forceExtDict(source, dest, compressedSize, maxOutputSize,
-                                                  lz4sd->externalDict, lz4sd->extDictSize);
+        if (lz4sd->extDictSize >= 64 KB)
+            result = LZ4_decompress_safe_extDict64k(source, dest, compressedSize, maxOutputSize,
+                                                    lz4sd->prefixEnd);
+        else
+            result = LZ4_decompress_safe_forceExtDict(source, dest, compressedSize, maxOutputSize,
+                                                      lz4sd->externalDict, lz4sd->extDictSize);
         if (result <= 0) return result;
         lz4sd->prefixSize = (size_t)result;
         lz4sd->prefixEnd  = (BYTE*)dest + result;
@@ -2727,6 +4124,9 @@ int LZ4_decompress_safe_usingDict(const char* source, char* dest, int compressed
         assert(dictSize >= 0);
         return LZ4_decompress_safe_withSmallPrefix(source, dest, compressedSize, maxOutputSize, (size_t)dictSize);
     }
+    if (dictSize >= 64 KB) {
+        return LZ4_decompress_safe_extDict64k(source, dest, compressedSize, maxOutputSize, dictStart + dictSize);
+    }
     assert(dictSize >= 0);
     return LZ4_decompress_safe_forceExtDict(source, dest, compressedSize, maxOutputSize, dictStart, (size_t)dictSize);
 }
@@ -2742,10 +4142,79 @@ int LZ4_decompress_safe_partial_usingDict(const char* source, char* dest, int co
         assert(dictSize >= 0);
         return LZ4_decompress_safe_partial_withSmallPrefix(source, dest, compressedSize, targetOutputSize, dstCapacity, (size_t)dictSize);
     }
+    if (dictSize >= 64 KB) {
+        return LZ4_decompress_safe_partial_extDict64k(source, dest, compressedSize, targetOutputSize, dstCapacity, dictStart + dictSize);
+    }
     assert(dictSize >= 0);
     return LZ4_decompress_safe_partial_forceExtDict(source, dest, compressedSize, targetOutputSize, dstCapacity, dictStart, (size_t)dictSize);
 }
 
+/* external dictionary, possibly followed by a prefix of @prefixSize bytes before @dest */
+LZ4_FORCE_O2
+static int LZ4_decompress_safe_extDict_withCheckpoints(const char* source, char* dest, int compressedSize, int maxOutputSize,
+                                                       size_t prefixSize, const char* dictStart, size_t dictSize,
+                                                       const LZ4_decCheckpoint_t* checkpoint)
+{
+    return LZ4_decompress_generic_checkpoints(source, dest, compressedSize, maxOutputSize,
+                                  decode_full_block, usingExtDict,
+                                  (BYTE*)dest - prefixSize, (const BYTE*)dictStart, dictSize,
+                                  checkpoint);
+}
+
+int LZ4_decompress_safe_usingDict_withCheckpoints(const char* source, char* dest, int compressedSize, int maxOutputSize,
+                                                  const char* dictStart, int dictSize,
+                                                  LZ4_checkpointFn checkpointFn, void* opaque, size_t interval)
+{
+    LZ4_decCheckpoint_t checkpoint;
+    if (checkpointFn == NULL)
+        return LZ4_decompress_safe_usingDict(source, dest, compressedSize, maxOutputSize, dictStart, dictSize);
+    checkpoint.fn = checkpointFn;
+    checkpoint.opaque = opaque;
+    checkpoint.interval = interval ? interval : 1;
+    if ((dictSize > 0) && (dictStart+dictSize != dest)) {
+        return LZ4_decompress_safe_extDict_withCheckpoints(source, dest, compressedSize, maxOutputSize,
+                                  0, dictStart, (size_t)dictSize, &checkpoint);
+    }
+    /* no dictionary, or dictionary is a prefix : a single instantiation covers both */
+    {   size_t const prefixSize = (dictSize > 0) ? MIN((size_t)dictSize, 64 KB) : 0;
+        return LZ4_decompress_generic_checkpoints(source, dest, compressedSize, maxOutputSize,
+                                  decode_full_block, noDict,
+                                  (BYTE*)dest - prefixSize, NULL, 0,
+                                  &checkpoint);
+    }
+}
+
+int LZ4_decompress_safe_usingSplitDict(const char* source, char* dest, int compressedSize, int maxOutputSize,
+                                       const char* dictStart, int dictSize, int prefixSize)
+{
+    if (prefixSize <= 0)
+        return LZ4_decompress_safe_usingDict(source, dest, compressedSize, maxOutputSize, dictStart, dictSize);
+    if ((dictSize <= 0) || (prefixSize >= 64 KB - 1))
+        return LZ4_decompress_safe_usingDict(source, dest, compressedSize, maxOutputSize, dest - prefixSize, prefixSize);
+    return LZ4_decompress_safe_doubleDict(source, dest, compressedSize, maxOutputSize,
+                                          (size_t)prefixSize, dictStart, (size_t)dictSize);
+}
+
+int LZ4_decompress_safe_usingSplitDict_withCheckpoints(const char* source, char* dest, int compressedSize, int maxOutputSize,
+                                                       const char* dictStart, int dictSize, int prefixSize,
+                                                       LZ4_checkpointFn checkpointFn, void* opaque, size_t interval)
+{
+    LZ4_decCheckpoint_t checkpoint;
+    if (prefixSize <= 0)
+        return LZ4_decompress_safe_usingDict_withCheckpoints(source, dest, compressedSize, maxOutputSize,
+                                                             dictStart, dictSize, checkpointFn, opaque, interval);
+    if ((dictSize <= 0) || (prefixSize >= 64 KB - 1))
+        return LZ4_decompress_safe_usingDict_withCheckpoints(source, dest, compressedSize, maxOutputSize,
+                                                             dest - prefixSize, prefixSize, checkpointFn, opaque, interval);
+    if (checkpointFn == NULL)
+        return LZ4_decompress_safe_usingSplitDict(source, dest, compressedSize, maxOutputSize, dictStart, dictSize, prefixSize);
+    checkpoint.fn = checkpointFn;
+    checkpoint.opaque = opaque;
+    checkpoint.interval = interval ? interval : 1;
+    return LZ4_decompress_safe_extDict_withCheckpoints(source, dest, compressedSize, maxOutputSize,
+                                  (size_t)prefixSize, dictStart, (size_t)dictSize, &checkpoint);
+}
+
 int LZ4_decompress_fast_usingDict(const char* source, char* dest, int originalSize, const char* dictStart, int dictSize)
 {
     if (dictSize==0 || dictStart+dictSize == dest)
@@ -231,7 +231,7 @@ LZ4LIB_API int LZ4_compressBound(int inputSize);
     It's a trade-off. It can be fine tuned, with each successive value providing roughly +~3% to speed.
     An acceleration value of "1" is the same as regular LZ4_compress_default()
     Values <= 0 will be replaced by LZ4_ACCELERATION_DEFAULT (currently == 1, see lz4.c).
-    Values > LZ4_ACCELERATION_MAX will be replaced by LZ4_ACCELERATION_MAX (currently == 65537, see lz4.c).
+    Values > LZ4_ACCELERATION_MAX will be replaced by LZ4_ACCELERATION_MAX (currently == 65537, see below).
 */
 LZ4LIB_API int LZ4_compress_fast (const char* src, char* dst, int srcSize, int dstCapacity, int acceleration);
 
@@ -597,6 +597,12 @@ LZ4_decompress_safe_partial_usingDict(const char* src, char* dst,
 # define LZ4LIB_STATIC_API
 #endif
 
+/*! LZ4_ACCELERATION_MAX :
+ *  Highest effective "acceleration" value; any larger value is treated as LZ4_ACCELERATION_MAX.
+ *  At this setting, compression is as fast as it gets, at the expense of compression ratio.
+ */
+#define LZ4_ACCELERATION_MAX 65537
+
 
 /*! LZ4_compress_fast_extState_fastReset() :
  *  A variant of LZ4_compress_fast_extState().
@@ -610,12 +616,270 @@ LZ4_decompress_safe_partial_usingDict(const char* src, char* dst,
  */
 LZ4LIB_STATIC_API int LZ4_compress_fast_extState_fastReset (void* state, const char* src, char* dst, int srcSize, int dstCapacity, int acceleration);
 
+/*! LZ4_compress_batch() :
+ *  Compresses many independent blocks in a single call, using a single state.
+ *  Each item is compressed as if by LZ4_compress_fast_extState_fastReset(), and can be decoded with LZ4_decompress_safe().
+ *  Since items are known to be independent, the hash table is re-used across successive small items (< 64 KB)
+ *  whenever it's valid to do so, instead of being cleared, which is beneficial for large amounts of small messages.
+ *  As a consequence, compressed result of an item can differ from LZ4_compress_fast_extState_fastReset() one.
+ *  @state must be correctly initialized already (same condition as LZ4_compress_fast_extState_fastReset()).
+ *  For each item, @cSize is written : compressed size, or 0 if compression failed (ex: @dstCapacity too small).
+ *  Items shall not overlap each other.
+ * @return : number of items successfully compressed (== @nbItems on full success).
+ */
+typedef struct {
+    const char* src;
+    char* dst;
+    int srcSize;
+    int dstCapacity;
+    int cSize;          /* output : compressed size, or 0 on failure */
+} LZ4_batchItem_t;
+LZ4LIB_STATIC_API int LZ4_compress_batch(void* state, LZ4_batchItem_t* items, int nbItems, int acceleration);
+
+/*! LZ4_looksIncompressible() :
+ *  Cheap heuristic, which samples ~1 KB of @src (byte histogram, and repeated 4-byte sequences),
+ *  in order to detect content which LZ4 can't compress, such as already compressed or encrypted data.
+ *  It can err in both directions, though it's designed to rarely flag compressible content.
+ * @return : 1 if @src looks incompressible,
+ *           0 otherwise, including when @srcSize is too small (< 8 KB) to be worth a probe.
+ */
+LZ4LIB_STATIC_API int LZ4_looksIncompressible(const char* src, int srcSize);
+
+/*! LZ4_compress_fast_extState_probe() :
+ *  Same as LZ4_compress_fast_extState(), but starts with LZ4_looksIncompressible().
+ *  When @src looks incompressible, the match search is skipped entirely :
+ *  - if @dstCapacity >= LZ4_compressBound(srcSize), @dst receives a literals-only block, at roughly memcpy() cost.
+ *  - otherwise, it returns 0, as LZ4_compress_fast_extState() would on failing to compress into @dstCapacity.
+ *    Callers are then expected to store @src uncompressed, like LZ4F does.
+ *  In all cases, @state is initialized, like LZ4_compress_fast_extState().
+ */
+LZ4LIB_STATIC_API int LZ4_compress_fast_extState_probe(void* state, const char* src, char* dst, int srcSize, int dstCapacity, int acceleration);
+
+/*! Shared dictionary : LZ4_CDict
+ *  A dictionary loaded once (using LZ4_loadDictSlow()), then referenced by any number of working states,
+ *  possibly from multiple threads concurrently, without copying its table.
+ *  LZ4_createCDict() copies the (last 64 KB of) dictionary content, so @dictBuffer can be released afterwards.
+ *  Once created, a LZ4_CDict is never modified : it's safe to share it across threads without synchronization.
+ *  Its lifetime is the caller's responsibility : it must outlive all compression calls using it.
+ */
+typedef struct LZ4_CDict_s LZ4_CDict;
+#if !defined(LZ4_STATIC_LINKING_ONLY_DISABLE_MEMORY_ALLOCATION)
+LZ4LIB_STATIC_API LZ4_CDict* LZ4_createCDict(const char* dictBuffer, int dictSize);
+LZ4LIB_STATIC_API void LZ4_freeCDict(LZ4_CDict* cdict);
+#endif
+
+/*! LZ4_attach_CDict() :
+ *  Same as LZ4_attach_dictionary(), using @cdict's pre-loaded stream. @cdict can be NULL.
+ */
+LZ4LIB_STATIC_API void LZ4_attach_CDict(LZ4_stream_t* workingStream, const LZ4_CDict* cdict);
+
+/*! LZ4_compress_fast_usingCDict() :
+ *  Compress @src as a single block, using @cdict as dictionary.
+ *  @state must be already initialized, typically once per thread, using LZ4_initStream() or LZ4_initStream_advanced().
+ *  It's then only reset with LZ4_resetStream_fast() at each call, which is cheap for small inputs.
+ *  Result is decoded with LZ4_decompress_safe_usingDict(), using the same dictionary content.
+ * @return : compressed size, or 0 if compression fails.
+ */
+LZ4LIB_STATIC_API int LZ4_compress_fast_usingCDict(void* state, const LZ4_CDict* cdict,
+                                                   const char* src, char* dst, int srcSize, int dstCapacity,
+                                                   int acceleration);
+
 /*! LZ4_compress_destSize_extState() : introduced in v1.10.0
  *  Same as LZ4_compress_destSize(), but using an externally allocated state.
  *  Also: exposes @acceleration
  */
 int LZ4_compress_destSize_extState(void* state, const char* src, char* dst, int* srcSizePtr, int targetDstSize, int acceleration);
 
+/*! LZ4_compress_destSize_multi() :
+ *  Packs as many sources as possible into a single @dst buffer of fixed size @targetDstSize (ex: a 16 KB slot),
+ *  each source being compressed into its own independent block, decodable with LZ4_decompress_safe().
+ *  Sources are consumed in order, and packing stops at the first one which doesn't fit into remaining space.
+ *  @blockOffsets : array of capacity >= @nbSources+1. On return, block n starts at @dst + blockOffsets[n],
+ *                  and its compressed size is blockOffsets[n+1] - blockOffsets[n].
+ *                  blockOffsets[result] is total nb of bytes written into @dst.
+ *  @state must be correctly initialized already (same condition as LZ4_compress_fast_extState_fastReset()).
+ * @return : nb of sources fully compressed into @dst, within [0, @nbSources].
+ */
+LZ4LIB_STATIC_API int LZ4_compress_destSize_multi(void* state,
+                                                  const char* const* srcs, const int* srcSizes, int nbSources,
+                                                  char* dst, int targetDstSize,
+                                                  int* blockOffsets, int acceleration);
+
+/*! LZ4_initStream_advanced() :
+ *  Same as LZ4_initStream(), but selects the size of the hash table at runtime,
+ *  instead of relying on compile-time LZ4_MEMORY_USAGE.
+ *  @hashLog : table has (1 << hashLog) cells of 4 bytes, within [LZ4_STREAM_HASHLOG_MIN, LZ4_STREAM_HASHLOG_MAX].
+ *             0 means "default", i.e. LZ4_HASHLOG.
+ *  A small table (ex: hashLog 10 => 4 KB) stays hot in L1 cache, which benefits small inputs,
+ *  while a large table (ex: hashLog 18 => 1 MB) finds more matches within large inputs.
+ *  @stateBuffer must be aligned like LZ4_stream_t, and @size must be >= LZ4_sizeofState_advanced(hashLog).
+ * @return : pointer to the initialized state, or NULL if a condition is not respected.
+ *
+ *  The selected table size is honored by LZ4_resetStream_fast(), LZ4_loadDict(), LZ4_loadDictSlow(),
+ *  LZ4_compress_fast_continue(), LZ4_compress_fast_extState_fastReset() and LZ4_saveDict().
+ *  Attaching a dictionary stream with a different table size is supported, but slower (dictionary is re-indexed).
+ *  Note : LZ4_compress_fast_extState(), LZ4_compress_destSize_extState() and LZ4_resetStream()
+ *         re-initialize the state with the default table size, hence require a buffer of size >= LZ4_sizeofState().
+ *         To re-initialize a state with a custom table size, invoke LZ4_initStream_advanced() again.
+ */
+#define LZ4_STREAM_HASHLOG_MIN (LZ4_MEMORY_USAGE_MIN-2)
+#define LZ4_STREAM_HASHLOG_MAX (LZ4_MEMORY_USAGE_MAX-2)
+LZ4LIB_STATIC_API LZ4_stream_t* LZ4_initStream_advanced(void* stateBuffer, size_t size, int hashLog);
+
+/*! LZ4_sizeofState_advanced() :
+ * @return : minimum size of a state buffer for LZ4_initStream_advanced() using @hashLog,
+ *           or 0 if @hashLog is outside of valid range.
+ *  Note : LZ4_sizeofState_advanced(0) == LZ4_sizeofState().
+ */
+LZ4LIB_STATIC_API int LZ4_sizeofState_advanced(int hashLog);
+
+/*! Custom memory allocation for states
+ *  LZ4_CustomMem gives control over size, alignment and placement of states,
+ *  for example to put many states into huge pages, or on the NUMA node of the thread using them.
+ *  @customAlloc receives the requested @size and @alignment (a power of 2, currently 64),
+ *               and @numaNode, copied from LZ4_CustomMem.numaNode (-1 meaning "no preference").
+ *               It must return memory aligned at least like malloc(), or NULL on failure.
+ *  @customFree receives the @size requested at allocation. It can be NULL, in which case nothing is freed :
+ *               memory is reclaimed by its owner, as with LZ4_arenaAlloc().
+ *  When @customAlloc is NULL, default malloc() / free() are used.
+ *  The same LZ4_CustomMem must be provided to create and free a state.
+ *
+ *  LZ4_createStream_advanced() allocates and initializes a state like LZ4_initStream_advanced(),
+ *  using @hashLog (0 means "default", see LZ4_initStream_advanced()).
+ *  It returns NULL if @hashLog is invalid or allocation fails.
+ *  LZ4_freeStream_advanced() must receive the same @hashLog, from which it computes the size given to @customFree.
+ */
+typedef void* (*LZ4_AllocFunction) (void* opaqueState, size_t size, size_t alignment, int numaNode);
+typedef void  (*LZ4_FreeFunction) (void* opaqueState, void* address, size_t size);
+typedef struct {
+    LZ4_AllocFunction customAlloc;
+    LZ4_FreeFunction customFree;
+    void* opaqueState;
+    int numaNode;
+} LZ4_CustomMem;
+
+LZ4LIB_STATIC_API LZ4_stream_t* LZ4_createStream_advanced(LZ4_CustomMem cmem, int hashLog);
+LZ4LIB_STATIC_API void LZ4_freeStream_advanced(LZ4_stream_t* streamPtr, LZ4_CustomMem cmem, int hashLog);
+
+/*! State arena
+ *  Carves states out of a single caller-provided buffer (ex: a 2 MB huge page), without any allocation.
+ *  LZ4_arenaAlloc() is a LZ4_AllocFunction : employ it with { LZ4_arenaAlloc, NULL, &arena, -1 }
+ *  to create states with LZ4_createStream_advanced() or LZ4_createStreamHC_advanced().
+ *  It returns NULL when remaining capacity is too small.
+ *  Memory is never given back individually : the whole buffer is reclaimed by its owner, or reused after LZ4_initArena().
+ *  An arena must not be used by multiple threads concurrently.
+ */
+typedef struct {
+    char* buffer;
+    size_t capacity;
+    size_t used;
+} LZ4_arena_t;
+
+LZ4LIB_STATIC_API void LZ4_initArena(LZ4_arena_t* arena, void* buffer, size_t capacity);
+LZ4LIB_STATIC_API void* LZ4_arenaAlloc(void* arena, size_t size, size_t alignment, int numaNode);
+
+/*! Resumable block decoder
+ *  Decodes one block in bounded steps, each one producing at most a chosen amount of output,
+ *  so that decoding a large block can be interleaved with other work, for example in a cooperative scheduler.
+ *  Decoding can be suspended anywhere, including in the middle of literals or of a match.
+ *
+ *  LZ4_initBlockDecoder() starts decoding the block @src of @srcSize bytes into @dst of @dstCapacity bytes.
+ *  Both buffers must remain valid and unmodified until decoding completes.
+ *  @history is optional (can be NULL) : when provided, it's used exactly as by LZ4_decompress_safe_continue(),
+ *  and it's updated the same way once the block is fully decoded.
+ *  Don't start another block on the same @history before this one completes.
+ *
+ *  LZ4_decompress_safe_step() decodes up to @maxOutputSize (> 0) bytes.
+ * @return : 1 when decoding is suspended, and more steps are needed,
+ *           0 once the block is fully decoded,
+ *           or a negative value if @src is malformed.
+ *  Same guarantees against malformed input as LZ4_decompress_safe(). Valid blocks are decoded identically,
+ *  but a few malformed blocks tolerated by LZ4_decompress_safe() (such as offset 0) are rejected.
+ *
+ *  LZ4_blockDecoder_decodedSize() tells how many bytes have been decoded into @dst so far.
+ *  They can be consumed right away, they won't be modified by future steps.
+ *
+ *  Fields of LZ4_blockDecoder_t are private, and may change in future versions.
+ */
+typedef struct {
+    const char* ip;
+    const char* iend;
+    char* op;
+    char* ostart;
+    char* oend;
+    const char* lowPrefix;       /* start of history within output buffer */
+    const char* dictEnd;         /* older history, in another buffer */
+    size_t dictSize;
+    const char* lit;             /* literals remaining to copy */
+    size_t litRemaining;
+    size_t matchRemaining;       /* match remaining to copy, after literals */
+    size_t offset;
+    LZ4_streamDecode_t* history;
+    int status;
+} LZ4_blockDecoder_t;
+LZ4LIB_STATIC_API int LZ4_initBlockDecoder(LZ4_blockDecoder_t* bd,
+                                const char* src, int srcSize, char* dst, int dstCapacity,
+                                LZ4_streamDecode_t* history);
+LZ4LIB_STATIC_API int LZ4_decompress_safe_step(LZ4_blockDecoder_t* bd, int maxOutputSize);
+LZ4LIB_STATIC_API int LZ4_blockDecoder_decodedSize(const LZ4_blockDecoder_t* bd);
+
+/*! LZ4_decompress_safe_usingDict_withCheckpoints() :
+ *  Same as LZ4_decompress_safe_usingDict(), but hands decoded data over to @checkpointFn during decoding,
+ *  in consecutive chunks of at least @interval bytes (the last one can be shorter), covering the whole output in order.
+ *  Chunks are final when handed over : the decoder won't modify them anymore.
+ *  This makes it possible to process output while it's still in cache, typically to checksum it,
+ *  instead of reading it again after decoding a large block.
+ *  When decoding fails, only part of the output may have been handed over.
+ */
+typedef void (*LZ4_checkpointFn)(void* opaque, const char* data, size_t size);
+LZ4LIB_STATIC_API int LZ4_decompress_safe_usingDict_withCheckpoints(const char* src, char* dst, int srcSize, int dstCapacity,
+                                const char* dictStart, int dictSize,
+                                LZ4_checkpointFn checkpointFn, void* opaque, size_t interval);
+
+/*! LZ4_decompress_safe_usingSplitDict() :
+ *  Same as LZ4_decompress_safe_usingDict(), but history is made of 2 discontiguous parts :
+ *  the @prefixSize bytes right before @dst, preceded by @dictStart/@dictSize, anywhere else in memory.
+ *  This is typical when decoding successive blocks into alternating output buffers :
+ *  history then continues from the end of the previous buffer into the beginning of the current one,
+ *  and doesn't need to be copied into a contiguous area.
+ *  LZ4_decompress_safe_usingSplitDict_withCheckpoints() does the same for LZ4_decompress_safe_usingDict_withCheckpoints().
+ */
+LZ4LIB_STATIC_API int LZ4_decompress_safe_usingSplitDict(const char* src, char* dst, int srcSize, int dstCapacity,
+                                const char* dictStart, int dictSize, int prefixSize);
+LZ4LIB_STATIC_API int LZ4_decompress_safe_usingSplitDict_withCheckpoints(const char* src, char* dst, int srcSize, int dstCapacity,
+                                const char* dictStart, int dictSize, int prefixSize,
+                                LZ4_checkpointFn checkpointFn, void* opaque, size_t interval);
+
+/*! Range decoding
+ *  Decodes bytes [rangeStart, rangeStart+rangeSize) of a block, without decoding the block from its start,
+ *  thanks to a sidecar index built once, typically at compression time, while decoded content is still at hand.
+ *
+ *  LZ4_buildRangeIndex() scans block @src, which decodes into @decoded (@decodedSize bytes),
+ *  and records a checkpoint at the first sequence starting after every @interval bytes of output.
+ *  Each checkpoint stores its position in @src and in decoded data,
+ *  plus the bytes preceding it which its segment references (its needed history).
+ *  Smaller intervals make ranges cheaper to decode, at the cost of a larger index.
+ *  Index format is endianness-independent.
+ * @return : index size, written into @index of @indexCapacity bytes,
+ *           or only measured when @index is NULL,
+ *           or a negative value if @src is malformed, doesn't decode into @decodedSize bytes, or @indexCapacity is too small.
+ *  Note : @decoded content itself isn't verified : it must be the result of decoding @src.
+ *
+ *  LZ4_decompress_safe_range() decodes one range into @dst, using @workspace as scratch buffer.
+ *  Decoding starts from the last checkpoint before @rangeStart, after restoring needed history into @workspace.
+ *  @workspaceSize must be >= LZ4_decompress_range_workspaceSize(index, indexSize, rangeSize),
+ *  which is ~64 KB + @interval + @rangeSize for typical data.
+ * @return : @rangeSize, or a negative value if the range, the index or @src is invalid.
+ *  Same guarantees against malformed @src as LZ4_decompress_safe(), including when the index is corrupted
+ *  (though a corrupted index may then result in wrong output).
+ */
+LZ4LIB_STATIC_API int LZ4_buildRangeIndex(const char* src, int srcSize, const char* decoded, int decodedSize,
+                                int interval, void* index, int indexCapacity);
+LZ4LIB_STATIC_API int LZ4_decompress_range_workspaceSize(const void* index, int indexSize, int rangeSize);
+LZ4LIB_STATIC_API int LZ4_decompress_safe_range(const char* src, int srcSize, const void* index, int indexSize,
+                                char* dst, int rangeStart, int rangeSize,
+                                void* workspace, int workspaceSize);
+
 /*! In-place compression and decompression
  *
  * It's possible to have input and output sharing the same buffer,
@@ -717,13 +981,13 @@ int LZ4_compress_destSize_extState(void* state, const char* src, char* dst, int*
 
 typedef struct LZ4_stream_t_internal LZ4_stream_t_internal;
 struct LZ4_stream_t_internal {
-    LZ4_u32 hashTable[LZ4_HASH_SIZE_U32];
     const LZ4_byte* dictionary;
     const LZ4_stream_t_internal* dictCtx;
     LZ4_u32 currentOffset;
     LZ4_u32 tableType;
     LZ4_u32 dictSize;
-    /* Implicit padding to ensure structure is aligned */
+    LZ4_u32 hashLog;   /* 0 means LZ4_HASHLOG; otherwise set by LZ4_initStream_advanced() */
+    LZ4_u32 hashTable[LZ4_HASH_SIZE_U32];   /* must remain last : can be smaller or larger when hashLog != LZ4_HASHLOG */
 };
 
 #define LZ4_STREAM_MINSIZE  ((1UL << (LZ4_MEMORY_USAGE)) + 32)  /* static size, for inter-version compatibility */
@@ -62,6 +62,16 @@
 #  define LZ4F_HEAPMODE 0
 #endif
 
+/*
+ * LZ4F_CHECKSUM_INTERVAL :
+ * When content checksum is enabled, LZ4F_decompress() hashes decoded data during block decompression,
+ * by chunks of this size, while they are still in cache, instead of reading the whole block again afterwards.
+ * 0 disables this : each block is hashed after being decoded.
+ */
+#ifndef LZ4F_CHECKSUM_INTERVAL
+#  define LZ4F_CHECKSUM_INTERVAL (128 KB)
+#endif
+
 
 /*-************************************
 *  Library declarations
@@ -943,21 +953,56 @@ static int LZ4F_compressBlockHC_continue(void* ctx, const char* src, char* dst,
     return LZ4_compress_HC_continue((LZ4_streamHC_t*)ctx, src, dst, srcSize, dstCapacity);
 }
 
+/* Variants used when LZ4F_preferences_t.skipIncompressible is set :
+ * blocks which look incompressible are not searched, and get stored uncompressed.
+ * Independent blocks simply skip compression.
+ * Linked fast blocks still go through the stream at maximum acceleration,
+ * which keeps history up to date for next block, at negligible cost.
+ * Linked HC blocks are compressed normally. */
+#define LZ4F_ACCELERATION_SKIP LZ4_ACCELERATION_MAX
+
+static int LZ4F_compressBlock_probe(void* ctx, const char* src, char* dst, int srcSize, int dstCapacity, int level, const LZ4F_CDict* cdict)
+{
+    if (LZ4_looksIncompressible(src, srcSize)) {
+        DEBUGLOG(5, "LZ4F_compressBlock_probe: skip incompressible block (srcSize=%i)", srcSize);
+        return 0;
+    }
+    return LZ4F_compressBlock(ctx, src, dst, srcSize, dstCapacity, level, cdict);
+}
+
+static int LZ4F_compressBlock_continue_probe(void* ctx, const char* src, char* dst, int srcSize, int dstCapacity, int level, const LZ4F_CDict* cdict)
+{
+    if (LZ4_looksIncompressible(src, srcSize)) {
+        DEBUGLOG(5, "LZ4F_compressBlock_continue_probe: skip incompressible block (srcSize=%i)", srcSize);
+        return LZ4_compress_fast_continue((LZ4_stream_t*)ctx, src, dst, srcSize, dstCapacity, LZ4F_ACCELERATION_SKIP);
+    }
+    return LZ4F_compressBlock_continue(ctx, src, dst, srcSize, dstCapacity, level, cdict);
+}
+
+static int LZ4F_compressBlockHC_probe(void* ctx, const char* src, char* dst, int srcSize, int dstCapacity, int level, const LZ4F_CDict* cdict)
+{
+    if (LZ4_looksIncompressible(src, srcSize)) {
+        DEBUGLOG(5, "LZ4F_compressBlockHC_probe: skip incompressible block (srcSize=%i)", srcSize);
+        return 0;
+    }
+    return LZ4F_compressBlockHC(ctx, src, dst, srcSize, dstCapacity, level, cdict);
+}
+
 static int LZ4F_doNotCompressBlock(void* ctx, const char* src, char* dst, int srcSize, int dstCapacity, int level, const LZ4F_CDict* cdict)
 {
     (void)ctx; (void)src; (void)dst; (void)srcSize; (void)dstCapacity; (void)level; (void)cdict;
     return 0;
 }
 
-static compressFunc_t LZ4F_selectCompression(LZ4F_blockMode_t blockMode, int level, LZ4F_BlockCompressMode_e  compressMode)
+static compressFunc_t LZ4F_selectCompression(LZ4F_blockMode_t blockMode, int level, LZ4F_BlockCompressMode_e  compressMode, unsigned skipIncompressible)
 {
     if (compressMode == LZ4B_UNCOMPRESSED)
         return LZ4F_doNotCompressBlock;
     if (level < LZ4HC_CLEVEL_MIN) {
-        if (blockMode == LZ4F_blockIndependent) return LZ4F_compressBlock;
-        return LZ4F_compressBlock_continue;
+        if (blockMode == LZ4F_blockIndependent) return skipIncompressible ? LZ4F_compressBlock_probe : LZ4F_compressBlock;
+        return skipIncompressible ? LZ4F_compressBlock_continue_probe : LZ4F_compressBlock_continue;
     }
-    if (blockMode == LZ4F_blockIndependent) return LZ4F_compressBlockHC;
+    if (blockMode == LZ4F_blockIndependent) return skipIncompressible ? LZ4F_compressBlockHC_probe : LZ4F_compressBlockHC;
     return LZ4F_compressBlockHC_continue;
 }
 
@@ -998,7 +1043,7 @@ static size_t LZ4F_compressUpdateImpl(LZ4F_cctx* cctxPtr,
     BYTE* const dstStart = (BYTE*)dstBuffer;
     BYTE* dstPtr = dstStart;
     LZ4F_lastBlockStatus lastBlockCompressed = notDone;
-    compressFunc_t const compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel, blockCompression);
+    compressFunc_t const compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel, blockCompression, cctxPtr->prefs.skipIncompressible);
     size_t bytesWritten;
     DEBUGLOG(4, "LZ4F_compressUpdate (srcSize=%zu)", srcSize);
 
@@ -1170,7 +1215,7 @@ size_t LZ4F_flush(LZ4F_cctx* cctxPtr,
     (void)compressOptionsPtr;   /* not useful (yet) */
 
     /* select compression function */
-    compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel, cctxPtr->blockCompressMode);
+    compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel, cctxPtr->blockCompressMode, cctxPtr->prefs.skipIncompressible);
 
     /* compress tmp buffer */
     dstPtr += LZ4F_makeBlock(dstPtr,
@@ -1241,6 +1286,161 @@ size_t LZ4F_compressEnd(LZ4F_cctx* cctxPtr,
 }
 
 
+/*-***************************************************
+*   Segmented compression
+*****************************************************/
+
+typedef struct {
+    const BYTE* src;
+    size_t srcSize;
+    size_t segmentSize;
+    BYTE* dst;              /* segment n is written at dst + n * segmentBound */
+    size_t segmentBound;
+    const LZ4F_preferences_t* prefs;
+    size_t* cSizes;         /* result of each segment : compressed size, or error code */
+} LZ4F_segmentJob_t;
+
+static size_t LZ4F_segmentSize(size_t segmentSize, size_t blockSize)
+{
+    if (segmentSize == 0) segmentSize = LZ4F_SEGMENT_SIZE_DEFAULT;
+    return (segmentSize + blockSize - 1) / blockSize * blockSize;
+}
+
+/* segments only contain blocks : no header, no end mark, no content checksum */
+static void LZ4F_segmentPrefs(LZ4F_preferences_t* segPrefs, const LZ4F_preferences_t* prefsPtr)
+{
+    if (prefsPtr != NULL) *segPrefs = *prefsPtr;
+    else MEM_INIT(segPrefs, 0, sizeof(*segPrefs));
+    if (segPrefs->frameInfo.blockSizeID == LZ4F_default)
+        segPrefs->frameInfo.blockSizeID = LZ4F_BLOCKSIZEID_DEFAULT;
+    segPrefs->frameInfo.contentChecksumFlag = LZ4F_noContentChecksum;
+    segPrefs->frameInfo.contentSize = 0;
+    segPrefs->autoFlush = 1;
+}
+
+size_t LZ4F_compressFrameBound_segmented(size_t srcSize, size_t segmentSize, const LZ4F_preferences_t* prefsPtr)
+{
+    LZ4F_preferences_t segPrefs;
+    LZ4F_segmentPrefs(&segPrefs, prefsPtr);
+    segmentSize = LZ4F_segmentSize(segmentSize, LZ4F_getBlockSize(segPrefs.frameInfo.blockSizeID));
+    {   size_t const nbSegments = (srcSize + segmentSize - 1) / segmentSize;
+        size_t const segmentBound = LZ4F_compressBound_internal(segmentSize, &segPrefs, 0);
+        return maxFHSize + (nbSegments * segmentBound) + BHSize + BFSize;
+    }
+}
+
+static void LZ4F_compressSegment(void* jobCtx, unsigned segmentNb)
+{
+    const LZ4F_segmentJob_t* const job = (const LZ4F_segmentJob_t*)jobCtx;
+    size_t const start = (size_t)segmentNb * job->segmentSize;
+    size_t const segSize = MIN(job->segmentSize, job->srcSize - start);
+    size_t const prefixSize = (job->prefs->frameInfo.blockMode == LZ4F_blockLinked) ? MIN(start, 64 KB) : 0;
+    BYTE* const dst = job->dst + (size_t)segmentNb * job->segmentBound;
+    LZ4F_cctx* const cctx = LZ4F_createCompressionContext_advanced(LZ4F_defaultCMem, LZ4F_VERSION);
+    LZ4F_compressOptions_t options;
+    size_t result;
+
+    DEBUGLOG(5, "LZ4F_compressSegment %u (start=%u, size=%u)", segmentNb, (unsigned)start, (unsigned)segSize);
+    assert(start < job->srcSize);
+    if (cctx == NULL) {
+        job->cSizes[segmentNb] = LZ4F_returnErrorCode(LZ4F_ERROR_allocation_failed);
+        return;
+    }
+    MEM_INIT(&options, 0, sizeof(options));
+    options.stableSrc = 1;
+    /* previous 64 KB of input is exactly the history the decoder will have */
+    result = LZ4F_compressBegin_usingDictOnce(cctx, dst, job->segmentBound,
+                                              prefixSize ? job->src + start - prefixSize : NULL, prefixSize,
+                                              job->prefs);
+    /* frame header is overwritten : only blocks are kept */
+    if (!LZ4F_isError(result))
+        result = LZ4F_compressUpdate(cctx, dst, job->segmentBound, job->src + start, segSize, &options);
+    LZ4F_freeCompressionContext(cctx);
+    job->cSizes[segmentNb] = result;
+}
+
+size_t LZ4F_compressFrame_segmented(void* dstBuffer, size_t dstCapacity,
+                              const void* srcBuffer, size_t srcSize,
+                                    size_t segmentSize,
+                              const LZ4F_preferences_t* prefsPtr,
+                                    LZ4F_parallelFor_f parallelFor, void* parallelForOpaque)
+{
+    LZ4F_preferences_t prefs;
+    LZ4F_preferences_t segPrefs;
+    LZ4F_segmentJob_t job;
+    BYTE* const dstStart = (BYTE*)dstBuffer;
+    BYTE* dstPtr = dstStart;
+    size_t nbSegments;
+    size_t result = 0;
+
+    DEBUGLOG(4, "LZ4F_compressFrame_segmented (srcSize=%u)", (unsigned)srcSize);
+    LZ4F_segmentPrefs(&segPrefs, prefsPtr);
+    prefs = segPrefs;
+    if (prefsPtr != NULL) {
+        prefs.frameInfo.contentChecksumFlag = prefsPtr->frameInfo.contentChecksumFlag;
+        if (prefsPtr->frameInfo.contentSize != 0)
+            prefs.frameInfo.contentSize = (U64)srcSize;   /* auto-correct content size if selected (!=0) */
+    }
+    {   size_t const blockSize = LZ4F_getBlockSize(prefs.frameInfo.blockSizeID);
+        FORWARD_IF_ERROR(blockSize);
+        segmentSize = LZ4F_segmentSize(segmentSize, blockSize);
+    }
+    nbSegments = (srcSize + segmentSize - 1) / segmentSize;
+    RETURN_ERROR_IF((size_t)(unsigned)nbSegments != nbSegments, parameter_invalid);
+    RETURN_ERROR_IF(dstCapacity < LZ4F_compressFrameBound_segmented(srcSize, segmentSize, &prefs), dstMaxSize_tooSmall);
+
+    /* Frame Header : compression level has no influence on it */
+    {   LZ4F_preferences_t headerPrefs = prefs;
+        LZ4F_cctx* const cctx = LZ4F_createCompressionContext_advanced(LZ4F_defaultCMem, LZ4F_VERSION);
+        RETURN_ERROR_IF(cctx == NULL, allocation_failed);
+        headerPrefs.compressionLevel = 0;
+        result = LZ4F_compressBegin(cctx, dstPtr, maxFHSize, &headerPrefs);
+        LZ4F_freeCompressionContext(cctx);
+        FORWARD_IF_ERROR(result);
+        dstPtr += result;
+    }
+
+    /* Segments */
+    if (nbSegments) {
+        size_t n;
+        job.src = (const BYTE*)srcBuffer;
+        job.srcSize = srcSize;
+        job.segmentSize = segmentSize;
+        job.dst = dstStart + maxFHSize;
+        job.segmentBound = LZ4F_compressBound_internal(segmentSize, &segPrefs, 0);
+        job.prefs = &segPrefs;
+        job.cSizes = (size_t*)LZ4F_malloc(nbSegments * sizeof(size_t), LZ4F_defaultCMem);
+        RETURN_ERROR_IF(job.cSizes == NULL, allocation_failed);
+        if (parallelFor != NULL) {
+            parallelFor(parallelForOpaque, LZ4F_compressSegment, &job, (unsigned)nbSegments);
+        } else {
+            for (n = 0; n < nbSegments; n++) LZ4F_compressSegment(&job, (unsigned)n);
+        }
+        /* pack segments : each one starts at or after dstPtr, so memmove() is enough */
+        for (n = 0; n < nbSegments; n++) {
+            result = job.cSizes[n];
+            if (LZ4F_isError(result)) break;
+            assert(dstPtr <= job.dst + n * job.segmentBound);
+            memmove(dstPtr, job.dst + n * job.segmentBound, result);
+            dstPtr += result;
+        }
+        LZ4F_free(job.cSizes, LZ4F_defaultCMem);
+        FORWARD_IF_ERROR(result);
+    }
+
+    /* End of frame */
+    LZ4F_writeLE32(dstPtr, 0);
+    dstPtr += 4;   /* endMark */
+    if (prefs.frameInfo.contentChecksumFlag == LZ4F_contentChecksumEnabled) {
+        LZ4F_writeLE32(dstPtr, XXH32(srcBuffer, srcSize, 0));
+        dstPtr += 4;   /* content Checksum */
+    }
+
+    assert(dstPtr <= dstStart + dstCapacity);
+    return (size_t)(dstPtr - dstStart);
+}
+
+
 /*-***************************************************
 *   Frame Decompression
 *****************************************************/
@@ -1271,6 +1471,8 @@ struct LZ4F_dctx_s {
     BYTE*  tmpOutBuffer;
     const BYTE* dict;
     size_t dictSize;
+    const BYTE* extDict;    /* when history is split : older part, before dict (which then starts a dst buffer) */
+    size_t extDictSize;
     BYTE*  tmpOut;
     size_t tmpOutSize;
     size_t tmpOutStart;
@@ -1330,6 +1532,8 @@ void LZ4F_resetDecompressionContext(LZ4F_dctx* dctx)
     dctx->dStage = dstage_getFrameHeader;
     dctx->dict = NULL;
     dctx->dictSize = 0;
+    dctx->extDict = NULL;
+    dctx->extDictSize = 0;
     dctx->skipChecksum = 0;
     dctx->frameRemainingSize = 0;
 }
@@ -1524,16 +1728,71 @@ LZ4F_errorCode_t LZ4F_getFrameInfo(LZ4F_dctx* dctx,
  * only used for LZ4F_blockLinked mode
  * Condition : @dstPtr != NULL
  */
+static void LZ4F_checksumCheckpoint(void* xxh, const char* data, size_t size)
+{
+    (void)XXH32_update((XXH32_state_t*)xxh, data, size);
+}
+
+/* Decodes one block, and updates content checksum if needed.
+ * When history is split, @dict is the part right before @dst, and dctx->extDict the older one. */
+static int LZ4F_decodeBlock(LZ4F_dctx* dctx,
+                            const char* src, char* dst, int srcSize, int dstCapacity,
+                            const char* dict, int dictSize)
+{
+    int const withChecksum = dctx->frameInfo.contentChecksumFlag && !dctx->skipChecksum;
+    const char* const extDict = (const char*)dctx->extDict;
+    int const extDictSize = (int)dctx->extDictSize;
+    int decodedSize;
+    assert((extDictSize == 0) || (dict + dictSize == dst));
+    if (withChecksum && (LZ4F_CHECKSUM_INTERVAL > 0)) {
+        if (extDictSize > 0)
+            return LZ4_decompress_safe_usingSplitDict_withCheckpoints(src, dst, srcSize, dstCapacity,
+                        extDict, extDictSize, dictSize,
+                        LZ4F_checksumCheckpoint, &dctx->xxh, LZ4F_CHECKSUM_INTERVAL);
+        return LZ4_decompress_safe_usingDict_withCheckpoints(src, dst, srcSize, dstCapacity,
+                        dict, dictSize,
+                        LZ4F_checksumCheckpoint, &dctx->xxh, LZ4F_CHECKSUM_INTERVAL);
+    }
+    if (extDictSize > 0)
+        decodedSize = LZ4_decompress_safe_usingSplitDict(src, dst, srcSize, dstCapacity, extDict, extDictSize, dictSize);
+    else
+        decodedSize = LZ4_decompress_safe_usingDict(src, dst, srcSize, dstCapacity, dict, dictSize);
+    if (withChecksum && (decodedSize > 0))
+        (void)XXH32_update(&dctx->xxh, dst, (size_t)decodedSize);
+    return decodedSize;
+}
+
+/* LZ4F_joinHistory() :
+ * gathers split history (extDict + dict) into tmpOutBuffer, keeping last 64 KB */
+static void LZ4F_joinHistory(LZ4F_dctx* dctx)
+{
+    size_t const dictSize = MIN(dctx->dictSize, 64 KB);
+    size_t const extSize = MIN(dctx->extDictSize, 64 KB - dictSize);
+    assert(dctx->extDictSize > 0);
+    assert(dctx->tmpOutBuffer != NULL);
+    assert(dctx->dict != dctx->tmpOutBuffer);
+    /* extDict may already be within tmpOutBuffer */
+    memmove(dctx->tmpOutBuffer, dctx->extDict + dctx->extDictSize - extSize, extSize);
+    memcpy(dctx->tmpOutBuffer + extSize, dctx->dict + dctx->dictSize - dictSize, dictSize);
+    dctx->dict = dctx->tmpOutBuffer;
+    dctx->dictSize = extSize + dictSize;
+    dctx->extDict = NULL;
+    dctx->extDictSize = 0;
+}
+
 static void LZ4F_updateDict(LZ4F_dctx* dctx,
                       const BYTE* dstPtr, size_t dstSize, const BYTE* dstBufferStart,
                       unsigned withinTmp)
 {
     assert(dstPtr != NULL);
+    if ((dctx->extDictSize > 0) && (dctx->dict + dctx->dictSize != dstPtr))
+        LZ4F_joinHistory(dctx);   /* history can't be split into 3 parts */
     if (dctx->dictSize==0) dctx->dict = (const BYTE*)dstPtr;  /* will lead to prefix mode */
     assert(dctx->dict != NULL);
 
     if (dctx->dict + dctx->dictSize == dstPtr) {  /* prefix mode, everything within dstBuffer */
         dctx->dictSize += dstSize;
+        if (dctx->dictSize >= 64 KB) dctx->extDictSize = 0;   /* older history no longer needed */
         return;
     }
 
@@ -1545,8 +1804,19 @@ static void LZ4F_updateDict(LZ4F_dctx* dctx,
     }
 
     assert(dstSize < 64 KB);   /* if dstSize >= 64 KB, dictionary would be set into dstBuffer directly */
+    assert(dctx->extDictSize == 0);
+
+    /* dstBuffer does not contain whole useful history (64 KB) :
+     * keep referencing older history where it is, and split history in 2 parts */
+    if (!withinTmp && (dstSize > 0)) {
+        dctx->extDictSize = MIN(dctx->dictSize, 64 KB);
+        dctx->extDict = dctx->dict + dctx->dictSize - dctx->extDictSize;
+        dctx->dict = dstPtr;
+        dctx->dictSize = dstSize;
+        return;
+    }
 
-    /* dstBuffer does not contain whole useful history (64 KB), so it must be saved within tmpOutBuffer */
+    /* otherwise, it must be saved within tmpOutBuffer */
     assert(dctx->tmpOutBuffer != NULL);
 
     if (withinTmp && (dctx->dict == dctx->tmpOutBuffer)) {   /* continue history within tmpOutBuffer */
@@ -1882,6 +2152,11 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
 #endif
             }   }
 
+            /* split history must end right before the decoded block */
+            if ( (dctx->extDictSize > 0)
+              && ( ((size_t)(dstEnd-dstPtr) < dctx->maxBlockSize) || (dctx->dict + dctx->dictSize != dstPtr) ) )
+                LZ4F_joinHistory(dctx);
+
             /* decode directly into destination buffer if there is enough room */
             if ( ((size_t)(dstEnd-dstPtr) >= dctx->maxBlockSize)
                  /* unless the dictionary is stored in tmpOut:
@@ -1898,13 +2173,11 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
                     dict += dictSize - 64 KB;
                     dictSize = 64 KB;
                 }
-                decodedSize = LZ4_decompress_safe_usingDict(
+                decodedSize = LZ4F_decodeBlock(dctx,
                         (const char*)selectedIn, (char*)dstPtr,
                         (int)dctx->tmpInTarget, (int)dctx->maxBlockSize,
                         dict, (int)dictSize);
                 RETURN_ERROR_IF(decodedSize < 0, decompressionFailed);
-                if ((dctx->frameInfo.contentChecksumFlag) && (!dctx->skipChecksum))
-                    XXH32_update(&(dctx->xxh), dstPtr, (size_t)decodedSize);
                 if (dctx->frameInfo.contentSize)
                     dctx->frameRemainingSize -= (size_t)decodedSize;
 
@@ -1943,13 +2216,11 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
                     dict += dictSize - 64 KB;
                     dictSize = 64 KB;
                 }
-                decodedSize = LZ4_decompress_safe_usingDict(
+                decodedSize = LZ4F_decodeBlock(dctx,
                         (const char*)selectedIn, (char*)dctx->tmpOut,
                         (int)dctx->tmpInTarget, (int)dctx->maxBlockSize,
                         dict, (int)dictSize);
                 RETURN_ERROR_IF(decodedSize < 0, decompressionFailed);
-                if (dctx->frameInfo.contentChecksumFlag && !dctx->skipChecksum)
-                    XXH32_update(&(dctx->xxh), dctx->tmpOut, (size_t)decodedSize);
                 if (dctx->frameInfo.contentSize)
                     dctx->frameRemainingSize -= (size_t)decodedSize;
                 dctx->tmpOutSize = (size_t)decodedSize;
@@ -2086,7 +2357,11 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
       && (!decompressOptionsPtr->stableDst)             /* cannot rely on dst data to remain there for next call */
       && ((unsigned)(dctx->dStage)-2 < (unsigned)(dstage_getSuffix)-2) )  /* valid stages : [init ... getSuffix[ */
     {
-        if (dctx->dStage == dstage_flushOut) {
+        if (dctx->extDictSize > 0) {
+            assert(dctx->dStage != dstage_flushOut);
+            LZ4F_joinHistory(dctx);
+            dctx->tmpOut = dctx->tmpOutBuffer + dctx->dictSize;
+        } else if (dctx->dStage == dstage_flushOut) {
             size_t const preserveSize = (size_t)(dctx->tmpOut - dctx->tmpOutBuffer);
             size_t copySize = 64 KB - dctx->tmpOutSize;
             const BYTE* oldDictEnd = dctx->dict + dctx->dictSize - dctx->tmpOutStart;
@@ -2129,8 +2404,118 @@ size_t LZ4F_decompress_usingDict(LZ4F_dctx* dctx,
     if (dctx->dStage <= dstage_init) {
         dctx->dict = (const BYTE*)dict;
         dctx->dictSize = dictSize;
+        dctx->extDict = NULL;
+        dctx->extDictSize = 0;
     }
     return LZ4F_decompress(dctx, dstBuffer, dstSizePtr,
                            srcBuffer, srcSizePtr,
                            decompressOptionsPtr);
 }
+
+
+/*==---   In-place decompression   ---==*/
+
+size_t LZ4F_decompress_inPlace(LZ4F_dctx* dctx, void* buffer, size_t bufferCapacity, size_t srcSize)
+{
+    BYTE* const ostart = (BYTE*)buffer;
+    BYTE* op = ostart;
+    const BYTE* const iend = ostart + bufferCapacity;
+    const BYTE* ip = iend - srcSize;
+
+    DEBUGLOG(5, "LZ4F_decompress_inPlace (capacity:%u, srcSize:%u)", (unsigned)bufferCapacity, (unsigned)srcSize);
+    RETURN_ERROR_IF(dctx == NULL, parameter_null);
+    RETURN_ERROR_IF(buffer == NULL, srcPtr_wrong);
+    RETURN_ERROR_IF(srcSize > bufferCapacity, srcSize_tooLarge);
+    RETURN_ERROR_IF(dctx->dStage != dstage_getFrameHeader, frameDecoding_alreadyStarted);
+
+    {   size_t const hSize = LZ4F_decodeHeader(dctx, ip, srcSize);
+        if (LZ4F_isError(hSize)) { LZ4F_resetDecompressionContext(dctx); return hSize; }
+        if (dctx->dStage != dstage_init) {
+            /* skippable frame, or incomplete header */
+            int const skippable = (dctx->frameInfo.frameType == LZ4F_skippableFrame);
+            LZ4F_resetDecompressionContext(dctx);
+            if (skippable) RETURN_ERROR(frameType_unknown);
+            RETURN_ERROR(frameHeader_incomplete);
+        }
+        ip += hSize;
+    }
+    if (dctx->frameInfo.contentChecksumFlag) (void)XXH32_reset(&(dctx->xxh), 0);
+    dctx->skipChecksum = 0;
+
+    for (;;) {
+        U32 blockHeader;
+        size_t blockSize;
+        const size_t crcSize = dctx->frameInfo.blockChecksumFlag * BFSize;
+        if ((size_t)(iend - ip) < BHSize) goto _srcSize_wrong;
+        blockHeader = LZ4F_readLE32(ip);
+        ip += BHSize;
+        blockSize = blockHeader & 0x7FFFFFFFU;
+        if (blockSize == 0) break;   /* end mark */
+        if (blockSize > dctx->maxBlockSize) { LZ4F_resetDecompressionContext(dctx); RETURN_ERROR(maxBlockSize_invalid); }
+        if ((size_t)(iend - ip) < blockSize + crcSize) goto _srcSize_wrong;
+        /* blocks are read front to back, and decoded data never overtakes them : op <= ip */
+        assert(op <= ip);
+
+        if (dctx->frameInfo.blockChecksumFlag) {
+            U32 const readBlockCrc = LZ4F_readLE32(ip + blockSize);
+            U32 const calcBlockCrc = XXH32(ip, blockSize, 0);
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+            if (readBlockCrc != calcBlockCrc) { LZ4F_resetDecompressionContext(dctx); RETURN_ERROR(blockChecksum_invalid); }
+#else
+            (void)readBlockCrc;
+            (void)calcBlockCrc;
+#endif
+        }
+
+        if (blockHeader & LZ4F_BLOCKUNCOMPRESSED_FLAG) {
+            /* stored block : output can't be larger than input */
+            memmove(op, ip, blockSize);
+            if (dctx->frameInfo.contentChecksumFlag)
+                (void)XXH32_update(&(dctx->xxh), op, blockSize);
+            op += blockSize;
+        } else {
+            /* decoded data must end at least LZ4_DECOMPRESS_INPLACE_MARGIN() before end of compressed block */
+            size_t const margin = LZ4_DECOMPRESS_INPLACE_MARGIN(blockSize);
+            size_t const room = (size_t)(ip + blockSize - op);
+            size_t const dstCapacity = (room > margin) ? MIN(room - margin, dctx->maxBlockSize) : 0;
+            size_t const prefixSize = (dctx->frameInfo.blockMode == LZ4F_blockLinked) ? MIN((size_t)(op - ostart), 64 KB) : 0;
+            int decodedSize;
+            if (dstCapacity == 0) { LZ4F_resetDecompressionContext(dctx); RETURN_ERROR(dstMaxSize_tooSmall); }
+            decodedSize = LZ4F_decodeBlock(dctx,
+                            (const char*)ip, (char*)op,
+                            (int)blockSize, (int)dstCapacity,
+                            (const char*)op - prefixSize, (int)prefixSize);
+            if (decodedSize < 0) {
+                LZ4F_resetDecompressionContext(dctx);
+                /* block may have been too large for the margin, or just corrupted */
+                if (dstCapacity < dctx->maxBlockSize) RETURN_ERROR(dstMaxSize_tooSmall);
+                RETURN_ERROR(decompressionFailed);
+            }
+            op += decodedSize;
+        }
+        ip += blockSize + crcSize;
+    }
+
+    if (dctx->frameInfo.contentChecksumFlag) {
+        if ((size_t)(iend - ip) < 4) goto _srcSize_wrong;
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+        if (LZ4F_readLE32(ip) != XXH32_digest(&(dctx->xxh))) {
+            LZ4F_resetDecompressionContext(dctx);
+            RETURN_ERROR(contentChecksum_invalid);
+        }
+#endif
+        ip += 4;
+    }
+    if (dctx->frameInfo.contentSize && (dctx->frameInfo.contentSize != (U64)(op - ostart))) {
+        LZ4F_resetDecompressionContext(dctx);
+        RETURN_ERROR(frameSize_wrong);
+    }
+    if (ip != iend) goto _srcSize_wrong;   /* trailing data */
+
+    LZ4F_resetDecompressionContext(dctx);
+    return (size_t)(op - ostart);
+
+_srcSize_wrong:
+    LZ4F_resetDecompressionContext(dctx);
+    RETURN_ERROR(frameSize_wrong);
+}
@@ -194,10 +194,11 @@ typedef struct {
   int      compressionLevel;    /* 0: default (fast mode); values > LZ4HC_CLEVEL_MAX count as LZ4HC_CLEVEL_MAX; values < 0 trigger "fast acceleration" */
   unsigned autoFlush;           /* 1: always flush; reduces usage of internal buffers */
   unsigned favorDecSpeed;       /* 1: parser favors decompression speed vs compression ratio. Only works for high compression modes (>= LZ4HC_CLEVEL_OPT_MIN) */  /* v1.8.2+ */
-  unsigned reserved[3];         /* must be zero for forward compatibility */
+  unsigned skipIncompressible;  /* 1: blocks which look incompressible (sampled) are stored uncompressed without searching for matches. Not applied to linked blocks in high compression modes */
+  unsigned reserved[2];         /* must be zero for forward compatibility */
 } LZ4F_preferences_t;
 
-#define LZ4F_INIT_PREFERENCES   { LZ4F_INIT_FRAMEINFO, 0, 0u, 0u, { 0u, 0u, 0u } }    /* v1.8.3+ */
+#define LZ4F_INIT_PREFERENCES   { LZ4F_INIT_FRAMEINFO, 0, 0u, 0u, 0u, { 0u, 0u } }    /* v1.8.3+ */
 
 
 /*-*********************************
@@ -374,6 +375,8 @@ typedef LZ4F_dctx* LZ4F_decompressionContext_t;   /* compatibility with previous
 typedef struct {
   unsigned stableDst;     /* pledges that last 64KB decompressed data is present right before @dstBuffer pointer.
                            * This optimization skips internal storage operations.
+                           * Alternatively, history may stay untouched where it was last decoded,
+                           * e.g. at the end of the previous @dstBuffer, when alternating between 2 buffers.
                            * Once set, this pledge must remain valid up to the end of current frame. */
   unsigned skipChecksums; /* disable checksum calculation and verification, even when one is present in frame, to save CPU time.
                            * Setting this option to 1 once disables all checksums for the rest of the frame. */
@@ -718,6 +721,81 @@ LZ4F_uncompressedUpdate(LZ4F_cctx* cctx,
                   const void* srcBuffer, size_t srcSize,
                   const LZ4F_compressOptions_t* cOptPtr);
 
+/**********************************
+ *  Segmented compression
+ *********************************/
+
+/*! Segmented compression : v1.10.x+
+ *  Compresses a large in-memory buffer into a single frame,
+ *  cut into segments which are compressed independently of each other, hence possibly in parallel.
+ *  In linked blocks mode, each segment uses the last 64 KB of the previous segment as dictionary,
+ *  so the result is a regular frame of dependent blocks, and compression ratio is barely affected.
+ *  The library doesn't create any thread : parallelism is provided by the caller, through @parallelFor.
+ */
+typedef void (*LZ4F_segmentJob_f)(void* jobCtx, unsigned segmentNb);
+typedef void (*LZ4F_parallelFor_f)(void* opaque, LZ4F_segmentJob_f job, void* jobCtx, unsigned nbSegments);
+
+#define LZ4F_SEGMENT_SIZE_DEFAULT (4 << 20)
+
+/*! LZ4F_compressFrameBound_segmented() :
+ * @return : minimum dstCapacity for LZ4F_compressFrame_segmented().
+ *  It's a bit larger than LZ4F_compressFrameBound(), since each segment gets its own worst-case capacity.
+ */
+LZ4FLIB_STATIC_API size_t LZ4F_compressFrameBound_segmented(size_t srcSize, size_t segmentSize,
+                                                     const LZ4F_preferences_t* prefsPtr);
+
+/*! LZ4F_compressFrame_segmented() :
+ *  Same result as LZ4F_compressFrame(), except that block boundaries restart at each segment.
+ * @segmentSize : 0 means LZ4F_SEGMENT_SIZE_DEFAULT. Rounded up to a multiple of block size.
+ * @parallelFor : must invoke job(jobCtx, n) for each n in [0, nbSegments), in any order, from any thread,
+ *                and only return once all jobs are completed.
+ *                NULL means segments are compressed sequentially, by the calling thread.
+ *  Output doesn't depend on @parallelFor, nor on the order in which jobs are run.
+ *  Each job allocates its own compression context. Segments are then packed into @dstBuffer by the calling thread,
+ *  which also generates the content checksum, if requested.
+ * @return : number of bytes written into @dstBuffer,
+ *           or an error code if it fails (can be tested using LZ4F_isError())
+ */
+LZ4FLIB_STATIC_API size_t
+LZ4F_compressFrame_segmented(void* dstBuffer, size_t dstCapacity,
+                       const void* srcBuffer, size_t srcSize,
+                             size_t segmentSize,
+                       const LZ4F_preferences_t* prefsPtr,
+                             LZ4F_parallelFor_f parallelFor, void* parallelForOpaque);
+
+/**********************************
+ *  In-place decompression
+ *********************************/
+
+/*! In-place decompression :
+ *  A whole frame is loaded at the end of a buffer, and decompressed into the beginning of the same buffer,
+ *  so that no separate input buffer is needed.
+ *
+ * |<------------------------buffer--------------------------------->|
+ *                             |<-----------compressed frame-------->|
+ * |<-----------decompressed size------------------>|
+ *
+ *  Decoded data progressively overwrites compressed data already read.
+ *  For each compressed block, decoded data must stop LZ4_DECOMPRESS_INPLACE_MARGIN(blockSize) bytes
+ *  before the end of that block : this is controlled before each block is decoded,
+ *  and decoding fails with LZ4F_ERROR_dstMaxSize_tooSmall if the buffer is too short.
+ *
+ *  LZ4F_DECOMPRESS_INPLACE_BUFFER_SIZE() is sufficient for frames of @contentSize bytes
+ *  which blocks are all full except the last one, such as frames generated by LZ4F_compressFrame().
+ *  Frames with many small blocks (after frequent flushes) may need more.
+ */
+#define LZ4F_DECOMPRESS_INPLACE_BUFFER_SIZE(contentSize, maxBlockSize) \
+    ((contentSize) + ((maxBlockSize) >> 8) + 32 + 8 * ((contentSize) / (maxBlockSize) + 2))
+
+/*! LZ4F_decompress_inPlace() :
+ *  Decompresses a single frame, stored in the last @srcSize bytes of @buffer, into the beginning of @buffer.
+ *  Supports all frame parameters, but no dictionary.
+ *  @dctx must be at the beginning of a frame, and is ready for a new frame when the function returns.
+ * @return : decompressed size, starting at @buffer,
+ *           or an error code (can be tested using LZ4F_isError()).
+ */
+LZ4FLIB_STATIC_API size_t LZ4F_decompress_inPlace(LZ4F_dctx* dctx, void* buffer, size_t bufferCapacity, size_t srcSize);
+
 /**********************************
  *  Custom memory allocation
  *********************************/
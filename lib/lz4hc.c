@@ -43,6 +43,9 @@
  *  allocate memory for their workspace:
  *  in stack (0:fastest), or in heap (1:default, requires malloc()).
  *  Since workspace is rather large, heap mode is recommended.
+ *  Note : levels 11+ only switch to their binary tree match finder in heap mode,
+ *  since its ~640 KB workspace doesn't fit on stack.
+ *  In stack mode, they keep using the hash chain match finder.
 **/
 #ifndef LZ4HC_HEAPMODE
 #  define LZ4HC_HEAPMODE 1
@@ -70,6 +73,7 @@
 
 /*===   Enums   ===*/
 typedef enum { noDictCtx, usingDictCtxHc } dictCtx_directive;
+typedef enum { defaultTables, customTables } tableSize_directive;   /* customTables : sizes read from state */
 
 
 /*===   Constants   ===*/
@@ -83,7 +87,7 @@ typedef enum { noDictCtx, usingDictCtxHc } dictCtx_directive;
 
 
 /*===   Levels definition   ===*/
-typedef enum { lz4mid, lz4hc, lz4opt } lz4hc_strat_e;
+typedef enum { lz4mid, lz4hc, lz4opt, lz4btopt } lz4hc_strat_e;
 typedef struct {
     lz4hc_strat_e strat;
     int nbSearches;
@@ -101,8 +105,8 @@ static const cParams_t k_clTable[LZ4HC_CLEVEL_MAX+1] = {
     { lz4hc,   128, 16 },  /* 8 */
     { lz4hc,   256, 16 },  /* 9 */
     { lz4opt,   96, 64 },  /*10==LZ4HC_CLEVEL_OPT_MIN*/
-    { lz4opt,  512,128 },  /*11 */
-    { lz4opt,16384,LZ4_OPT_NUM },  /* 12==LZ4HC_CLEVEL_MAX */
+    { lz4btopt, 512,128 },  /*11 */
+    { lz4btopt,16384,LZ4_OPT_NUM },  /* 12==LZ4HC_CLEVEL_MAX */
 };
 
 static cParams_t LZ4HC_getCLevelParams(int cLevel)
@@ -115,11 +119,44 @@ static cParams_t LZ4HC_getCLevelParams(int cLevel)
     return k_clTable[cLevel];
 }
 
+LZ4HC_cParams_t LZ4_getCompressionParametersHC(int compressionLevel)
+{
+    cParams_t const cParam = LZ4HC_getCLevelParams(compressionLevel);
+    LZ4HC_cParams_t params;
+    params.strategy = (cParam.strat == lz4mid) ? LZ4HC_strat_mid :
+                      (cParam.strat == lz4hc)  ? LZ4HC_strat_hc :
+                      (cParam.strat == lz4opt) ? LZ4HC_strat_opt : LZ4HC_strat_btopt;
+    params.nbSearches = cParam.nbSearches;
+    params.targetLength = (int)cParam.targetLength;
+    return params;
+}
+
+/* LZ4HC_importCParams() :
+ * validates user parameters, and clamps them into supported range.
+ * @return : 1 on success, 0 if @params is invalid */
+static int LZ4HC_importCParams(cParams_t* cParam, const LZ4HC_cParams_t* params)
+{
+    LZ4_STATIC_ASSERT(LZ4HC_TARGETLENGTH_MAX == LZ4_OPT_NUM);
+    if (params == NULL) return 0;
+    switch (params->strategy) {
+    case LZ4HC_strat_mid:   cParam->strat = lz4mid; break;
+    case LZ4HC_strat_hc:    cParam->strat = lz4hc; break;
+    case LZ4HC_strat_opt:   cParam->strat = lz4opt; break;
+    case LZ4HC_strat_btopt: cParam->strat = lz4btopt; break;
+    default: return 0;
+    }
+    cParam->nbSearches = MAX(params->nbSearches, 1);
+    cParam->targetLength = (U32)MIN(MAX(params->targetLength, LZ4HC_TARGETLENGTH_MIN), LZ4HC_TARGETLENGTH_MAX);
+    return 1;
+}
+
 
 /*===   Hashing   ===*/
 #define LZ4HC_HASHSIZE 4
 #define HASH_FUNCTION(i)      (((i) * 2654435761U) >> ((MINMATCH*8)-LZ4HC_HASH_LOG))
 static U32 LZ4HC_hashPtr(const void* ptr) { return HASH_FUNCTION(LZ4_read32(ptr)); }
+/* same hash, for a table of 2^hashLog entries; identical to LZ4HC_hashPtr() for LZ4HC_HASH_LOG */
+static U32 LZ4HC_hashPtrLog(const void* ptr, U32 hashLog) { return (LZ4_read32(ptr) * 2654435761U) >> ((MINMATCH*8)-hashLog); }
 
 #if defined(LZ4_FORCE_MEMORY_ACCESS) && (LZ4_FORCE_MEMORY_ACCESS==2)
 /* lie to the compiler about data alignment; use with caution */
@@ -139,16 +176,15 @@ static U64 LZ4_read64(const void* memPtr)
 #endif /* LZ4_FORCE_MEMORY_ACCESS */
 
 #define LZ4MID_HASHSIZE 8
-#define LZ4MID_HASHLOG (LZ4HC_HASH_LOG-1)
-#define LZ4MID_HASHTABLESIZE (1 << LZ4MID_HASHLOG)
+/* LZ4MID splits the hash table into 2 halves, of 2^(hashLog-1) entries each */
 
-static U32 LZ4MID_hash4(U32 v) { return (v * 2654435761U) >> (32-LZ4MID_HASHLOG); }
-static U32 LZ4MID_hash4Ptr(const void* ptr) { return LZ4MID_hash4(LZ4_read32(ptr)); }
+static U32 LZ4MID_hash4(U32 v, U32 midLog) { return (v * 2654435761U) >> (32-midLog); }
+static U32 LZ4MID_hash4Ptr(const void* ptr, U32 midLog) { return LZ4MID_hash4(LZ4_read32(ptr), midLog); }
 /* note: hash7 hashes the lower 56-bits.
  * It presumes input was read using little endian.*/
-static U32 LZ4MID_hash7(U64 v) { return (U32)(((v  << (64-56)) * 58295818150454627ULL) >> (64-LZ4MID_HASHLOG)) ; }
+static U32 LZ4MID_hash7(U64 v, U32 midLog) { return (U32)(((v  << (64-56)) * 58295818150454627ULL) >> (64-midLog)) ; }
 static U64 LZ4_readLE64(const void* memPtr);
-static U32 LZ4MID_hash8Ptr(const void* ptr) { return LZ4MID_hash7(LZ4_readLE64(ptr)); }
+static U32 LZ4MID_hash8Ptr(const void* ptr, U32 midLog) { return LZ4MID_hash7(LZ4_readLE64(ptr), midLog); }
 
 static U64 LZ4_readLE64(const void* memPtr)
 {
@@ -224,8 +260,54 @@ int LZ4HC_countBack(const BYTE* const ip, const BYTE* const match,
     return back;
 }
 
+/*===   Tables   ===*/
+/* tableLogs : 0 means default sizes, so that a zeroed state remains valid.
+ * low nibble : hashLog - LZ4HC_HASH_LOG, as a signed 4-bit value ;
+ * high nibble : LZ4HC_DICTIONARY_LOGSIZE - chainLog */
+LZ4_FORCE_INLINE U32 LZ4HC_hashLog(const LZ4HC_CCtx_internal* hc4, const tableSize_directive tables)
+{
+    if (tables == defaultTables) { assert(hc4->tableLogs == 0); return LZ4HC_HASH_LOG; }
+    return (U32)(LZ4HC_HASH_LOG + (int)((hc4->tableLogs & 15) ^ 8) - 8);
+}
+LZ4_FORCE_INLINE U32 LZ4HC_chainLog(const LZ4HC_CCtx_internal* hc4, const tableSize_directive tables)
+{
+    if (tables == defaultTables) { assert(hc4->tableLogs == 0); return LZ4HC_DICTIONARY_LOGSIZE; }
+    return LZ4HC_DICTIONARY_LOGSIZE - (U32)(hc4->tableLogs >> 4);
+}
+static BYTE LZ4HC_tableLogs(U32 hashLog, U32 chainLog)
+{
+    assert(hashLog >= LZ4HC_HASHLOG_MIN && hashLog <= LZ4HC_HASHLOG_MAX);
+    assert(chainLog >= LZ4HC_CHAINLOG_MIN && chainLog <= LZ4HC_CHAINLOG_MAX);
+    return (BYTE)(((hashLog - LZ4HC_HASH_LOG) & 15) | ((LZ4HC_DICTIONARY_LOGSIZE - chainLog) << 4));
+}
+
+/* chain table follows hash table, whatever their sizes */
+LZ4_FORCE_INLINE U16* LZ4HC_chainTable(LZ4HC_CCtx_internal* hc4, U32 hashLog)
+{
+    return (U16*)(void*)(hc4->hashTable + ((size_t)1 << hashLog));
+}
+LZ4_FORCE_INLINE const U16* LZ4HC_chainTableConst(const LZ4HC_CCtx_internal* hc4, U32 hashLog)
+{
+    return (const U16*)(const void*)(hc4->hashTable + ((size_t)1 << hashLog));
+}
+
+/* chain table can only reference positions it still holds */
+LZ4_FORCE_INLINE U32 LZ4HC_maxDistance(U32 chainLog)
+{
+    return MIN(LZ4_DISTANCE_MAX, (1U << chainLog) - 1);
+}
+
+/* LZ4HC_stateSize() :
+ * size of a state employing tables of (1 << hashLog) and (1 << chainLog) cells.
+ * Since tables are the last members of LZ4HC_CCtx_internal,
+ * they can be shorter or longer than the statically allocated ones. */
+static size_t LZ4HC_stateSize(U32 hashLog, U32 chainLog)
+{
+    return offsetof(LZ4HC_CCtx_internal, hashTable) + (sizeof(U32) << hashLog) + (sizeof(U16) << chainLog);
+}
+
 /*===   Chain table updates   ===*/
-#define DELTANEXTU16(table, pos) table[(U16)(pos)]   /* faster */
+#define DELTANEXT(table, mask, pos) table[(pos) & (mask)]
 /* Make fields passed to, and updated by LZ4HC_encodeSequence explicit */
 #define UPDATABLE(ip, op, anchor) &ip, &op, &anchor
 
@@ -235,8 +317,18 @@ int LZ4HC_countBack(const BYTE* const ip, const BYTE* const match,
 **************************************/
 static void LZ4HC_clearTables (LZ4HC_CCtx_internal* hc4)
 {
-    MEM_INIT(hc4->hashTable, 0, sizeof(hc4->hashTable));
-    MEM_INIT(hc4->chainTable, 0xFF, sizeof(hc4->chainTable));
+    U32 const hashLog = LZ4HC_hashLog(hc4, customTables);
+    MEM_INIT(hc4->hashTable, 0, sizeof(U32) << hashLog);
+    MEM_INIT(LZ4HC_chainTable(hc4, hashLog), 0xFF, sizeof(U16) << LZ4HC_chainLog(hc4, customTables));
+}
+
+/* LZ4HC_resetState() :
+ * full reset, preserving table sizes */
+static void LZ4HC_resetState (LZ4HC_CCtx_internal* hc4)
+{
+    BYTE const tableLogs = hc4->tableLogs;
+    MEM_INIT(hc4, 0, LZ4HC_stateSize(LZ4HC_hashLog(hc4, customTables), LZ4HC_chainLog(hc4, customTables)));
+    hc4->tableLogs = tableLogs;
 }
 
 static void LZ4HC_init_internal (LZ4HC_CCtx_internal* hc4, const BYTE* start)
@@ -366,13 +458,19 @@ LZ4HC_match_t LZ4HC_searchExtDict(const BYTE* ip, U32 ipIndex,
         int currentBestML, int nbAttempts)
 {
     size_t const lDictEndIndex = (size_t)(dictCtx->end - dictCtx->prefixStart) + dictCtx->dictLimit;
-    U32 lDictMatchIndex = dictCtx->hashTable[LZ4HC_hashPtr(ip)];
+    U32 const dictHashLog = LZ4HC_hashLog(dictCtx, customTables);
+    U32 const dictChainLog = LZ4HC_chainLog(dictCtx, customTables);
+    const U32* const dictHashTable = dictCtx->hashTable;   /* may be larger than declared array */
+    const U16* const dictChainTable = LZ4HC_chainTableConst(dictCtx, dictHashLog);
+    U32 const dictChainMask = (1U << dictChainLog) - 1;
+    U32 const maxDistance = LZ4HC_maxDistance(dictChainLog);
+    U32 lDictMatchIndex = dictHashTable[LZ4HC_hashPtrLog(ip, dictHashLog)];
     U32 matchIndex = lDictMatchIndex + gDictEndIndex - (U32)lDictEndIndex;
     int offset = 0, sBack = 0;
     assert(lDictEndIndex <= 1 GB);
     if (lDictMatchIndex>0)
         DEBUGLOG(7, "lDictEndIndex = %zu, lDictMatchIndex = %u", lDictEndIndex, lDictMatchIndex);
-    while (ipIndex - matchIndex <= LZ4_DISTANCE_MAX && nbAttempts--) {
+    while (ipIndex - matchIndex <= maxDistance && nbAttempts--) {
         const BYTE* const matchPtr = dictCtx->prefixStart - dictCtx->dictLimit + lDictMatchIndex;
 
         if (LZ4_read32(matchPtr) == LZ4_read32(ip)) {
@@ -390,7 +488,7 @@ LZ4HC_match_t LZ4HC_searchExtDict(const BYTE* ip, U32 ipIndex,
                 DEBUGLOG(7, "found match of length %i within extDictCtx", currentBestML);
         }   }
 
-        {   U32 const nextOffset = DELTANEXTU16(dictCtx->chainTable, lDictMatchIndex);
+        {   U32 const nextOffset = DELTANEXT(dictChainTable, dictChainMask, lDictMatchIndex);
             lDictMatchIndex -= nextOffset;
             matchIndex -= nextOffset;
     }   }
@@ -422,12 +520,13 @@ static LZ4HC_match_t LZ4MID_searchExtDict(const BYTE* ip, U32 ipIndex,
         const LZ4HC_CCtx_internal* dictCtx, U32 gDictEndIndex)
 {
     size_t const lDictEndIndex = (size_t)(dictCtx->end - dictCtx->prefixStart) + dictCtx->dictLimit;
+    U32 const midLog = LZ4HC_hashLog(dictCtx, customTables) - 1;
     const U32* const hash4Table = dictCtx->hashTable;
-    const U32* const hash8Table = hash4Table + LZ4MID_HASHTABLESIZE;
+    const U32* const hash8Table = hash4Table + ((size_t)1 << midLog);
     DEBUGLOG(7, "LZ4MID_searchExtDict (ipIdx=%u)", ipIndex);
 
     /* search long match first */
-    {   U32 l8DictMatchIndex = hash8Table[LZ4MID_hash8Ptr(ip)];
+    {   U32 l8DictMatchIndex = hash8Table[LZ4MID_hash8Ptr(ip, midLog)];
         U32 m8Index = l8DictMatchIndex + gDictEndIndex - (U32)lDictEndIndex;
         assert(lDictEndIndex <= 1 GB);
         if (ipIndex - m8Index <= LZ4_DISTANCE_MAX) {
@@ -446,7 +545,7 @@ static LZ4HC_match_t LZ4MID_searchExtDict(const BYTE* ip, U32 ipIndex,
     }
 
     /* search for short match second */
-    {   U32 l4DictMatchIndex = hash4Table[LZ4MID_hash4Ptr(ip)];
+    {   U32 l4DictMatchIndex = hash4Table[LZ4MID_hash4Ptr(ip, midLog)];
         U32 m4Index = l4DictMatchIndex + gDictEndIndex - (U32)lDictEndIndex;
         if (ipIndex - m4Index <= LZ4_DISTANCE_MAX) {
             const BYTE* const matchPtr = dictCtx->prefixStart - dictCtx->dictLimit + l4DictMatchIndex;
@@ -479,16 +578,17 @@ LZ4MID_addPosition(U32* hTable, U32 hValue, U32 index)
     hTable[hValue] = index;
 }
 
-#define ADDPOS8(_p, _idx) LZ4MID_addPosition(hash8Table, LZ4MID_hash8Ptr(_p), _idx)
-#define ADDPOS4(_p, _idx) LZ4MID_addPosition(hash4Table, LZ4MID_hash4Ptr(_p), _idx)
+#define ADDPOS8(_p, _idx) LZ4MID_addPosition(hash8Table, LZ4MID_hash8Ptr(_p, midLog), _idx)
+#define ADDPOS4(_p, _idx) LZ4MID_addPosition(hash4Table, LZ4MID_hash4Ptr(_p, midLog), _idx)
 
 /* Fill hash tables with references into dictionary.
  * The resulting table is only exploitable by LZ4MID (level 2) */
 static void
 LZ4MID_fillHTable (LZ4HC_CCtx_internal* cctx, const void* dict, size_t size)
 {
+    U32 const midLog = LZ4HC_hashLog(cctx, customTables) - 1;
     U32* const hash4Table = cctx->hashTable;
-    U32* const hash8Table = hash4Table + LZ4MID_HASHTABLESIZE;
+    U32* const hash8Table = hash4Table + ((size_t)1 << midLog);
     const BYTE* const prefixPtr = (const BYTE*)dict;
     U32 const prefixIdx = cctx->dictLimit;
     U32 const target = prefixIdx + (U32)size - LZ4MID_HASHSIZE;
@@ -529,8 +629,9 @@ static int LZ4MID_compress (
     const dictCtx_directive dict
     )
 {
+    U32 const midLog = LZ4HC_hashLog(ctx, customTables) - 1;
     U32* const hash4Table = ctx->hashTable;
-    U32* const hash8Table = hash4Table + LZ4MID_HASHTABLESIZE;
+    U32* const hash8Table = hash4Table + ((size_t)1 << midLog);
     const BYTE* ip = (const BYTE*)src;
     const BYTE* anchor = ip;
     const BYTE* const iend = ip + *srcSizePtr;
@@ -570,9 +671,9 @@ static int LZ4MID_compress (
     while (ip <= mflimit) {
         const U32 ipIndex = (U32)(ip - prefixPtr) + prefixIdx;
         /* search long match */
-        {   U32 const h8 = LZ4MID_hash8Ptr(ip);
+        {   U32 const h8 = LZ4MID_hash8Ptr(ip, midLog);
             U32 const pos8 = hash8Table[h8];
-            assert(h8 < LZ4MID_HASHTABLESIZE);
+            assert(h8 < (1U << midLog));
             assert(pos8 < ipIndex);
             LZ4MID_addPosition(hash8Table, h8, ipIndex);
             if (ipIndex - pos8 <= LZ4_DISTANCE_MAX) {
@@ -601,9 +702,9 @@ static int LZ4MID_compress (
                 }
         }   }
         /* search short match */
-        {   U32 const h4 = LZ4MID_hash4Ptr(ip);
+        {   U32 const h4 = LZ4MID_hash4Ptr(ip, midLog);
             U32 const pos4 = hash4Table[h4];
-            assert(h4 < LZ4MID_HASHTABLESIZE);
+            assert(h4 < (1U << midLog));
             assert(pos4 < ipIndex);
             LZ4MID_addPosition(hash4Table, h4, ipIndex);
             if (ipIndex - pos4 <= LZ4_DISTANCE_MAX) {
@@ -616,7 +717,7 @@ static int LZ4MID_compress (
                     matchLength = LZ4_count(ip, matchPtr, matchlimit);
                     if (matchLength >= MINMATCH) {
                         /* short match found, let's just check ip+1 for longer */
-                        U32 const h8 = LZ4MID_hash8Ptr(ip+1);
+                        U32 const h8 = LZ4MID_hash8Ptr(ip+1, midLog);
                         U32 const pos8 = hash8Table[h8];
                         U32 const m2Distance = ipIndex + 1 - pos8;
                         matchDistance = ipIndex - pos4;
@@ -778,10 +879,14 @@ _lz4mid_dest_overflow:
 **************************************/
 
 /* Update chains up to ip (excluded) */
-LZ4_FORCE_INLINE void LZ4HC_Insert (LZ4HC_CCtx_internal* hc4, const BYTE* ip)
+LZ4_FORCE_INLINE void LZ4HC_Insert (LZ4HC_CCtx_internal* hc4, const BYTE* ip, const tableSize_directive tables)
 {
-    U16* const chainTable = hc4->chainTable;
+    U32 const hashLog = LZ4HC_hashLog(hc4, tables);
+    U32 const chainLog = LZ4HC_chainLog(hc4, tables);
+    U16* const chainTable = LZ4HC_chainTable(hc4, hashLog);
     U32* const hashTable  = hc4->hashTable;
+    U32 const chainMask = (1U << chainLog) - 1;
+    U32 const maxDistance = LZ4HC_maxDistance(chainLog);
     const BYTE* const prefixPtr = hc4->prefixStart;
     U32 const prefixIdx = hc4->dictLimit;
     U32 const target = (U32)(ip - prefixPtr) + prefixIdx;
@@ -790,10 +895,10 @@ LZ4_FORCE_INLINE void LZ4HC_Insert (LZ4HC_CCtx_internal* hc4, const BYTE* ip)
     assert(target >= prefixIdx);
 
     while (idx < target) {
-        U32 const h = LZ4HC_hashPtr(prefixPtr+idx-prefixIdx);
+        U32 const h = LZ4HC_hashPtrLog(prefixPtr+idx-prefixIdx, hashLog);
         size_t delta = idx - hashTable[h];
-        if (delta>LZ4_DISTANCE_MAX) delta = LZ4_DISTANCE_MAX;
-        DELTANEXTU16(chainTable, idx) = (U16)delta;
+        if (delta>maxDistance) delta = maxDistance;
+        DELTANEXT(chainTable, chainMask, idx) = (U16)delta;
         hashTable[h] = idx;
         idx++;
     }
@@ -890,16 +995,22 @@ LZ4HC_InsertAndGetWiderMatch (
         const int maxNbAttempts,
         const int patternAnalysis, const int chainSwap,
         const dictCtx_directive dict,
-        const HCfavor_e favorDecSpeed)
+        const tableSize_directive tables,
+        const HCfavor_e favorDecSpeed,
+        size_t* nbAttemptsPtr)   /* optional : accumulates nb of attempts */
 {
-    U16* const chainTable = hc4->chainTable;
-    U32* const hashTable = hc4->hashTable;
+    const U32 hashLog = LZ4HC_hashLog(hc4, tables);
+    const U32 chainLog = LZ4HC_chainLog(hc4, tables);
+    const U16* const chainTable = LZ4HC_chainTable(hc4, hashLog);
+    const U32* const hashTable = hc4->hashTable;
+    const U32 chainMask = (1U << chainLog) - 1;
+    const U32 maxDistance = LZ4HC_maxDistance(chainLog);
     const LZ4HC_CCtx_internal* const dictCtx = hc4->dictCtx;
     const BYTE* const prefixPtr = hc4->prefixStart;
     const U32 prefixIdx = hc4->dictLimit;
     const U32 ipIndex = (U32)(ip - prefixPtr) + prefixIdx;
-    const int withinStartDistance = (hc4->lowLimit + (LZ4_DISTANCE_MAX + 1) > ipIndex);
-    const U32 lowestMatchIndex = (withinStartDistance) ? hc4->lowLimit : ipIndex - LZ4_DISTANCE_MAX;
+    const int withinStartDistance = (hc4->lowLimit + (maxDistance + 1) > ipIndex);
+    const U32 lowestMatchIndex = (withinStartDistance) ? hc4->lowLimit : ipIndex - maxDistance;
     const BYTE* const dictStart = hc4->dictStart;
     const U32 dictIdx = hc4->lowLimit;
     const BYTE* const dictEnd = dictStart + prefixIdx - dictIdx;
@@ -914,8 +1025,8 @@ LZ4HC_InsertAndGetWiderMatch (
 
     DEBUGLOG(7, "LZ4HC_InsertAndGetWiderMatch");
     /* First Match */
-    LZ4HC_Insert(hc4, ip);  /* insert all prior positions up to ip (excluded) */
-    matchIndex = hashTable[LZ4HC_hashPtr(ip)];
+    LZ4HC_Insert(hc4, ip, tables);  /* insert all prior positions up to ip (excluded) */
+    matchIndex = hashTable[LZ4HC_hashPtrLog(ip, hashLog)];
     DEBUGLOG(7, "First candidate match for pos %u found at index %u / %u (lowestMatchIndex)",
                 ipIndex, matchIndex, lowestMatchIndex);
 
@@ -971,7 +1082,7 @@ LZ4HC_InsertAndGetWiderMatch (
                 int accel = 1 << kTrigger;
                 int pos;
                 for (pos = 0; pos < end; pos += step) {
-                    U32 const candidateDist = DELTANEXTU16(chainTable, matchIndex + (U32)pos);
+                    U32 const candidateDist = DELTANEXT(chainTable, chainMask, matchIndex + (U32)pos);
                     step = (accel++ >> kTrigger);
                     if (candidateDist > distanceToNextMatch) {
                         distanceToNextMatch = candidateDist;
@@ -984,7 +1095,7 @@ LZ4HC_InsertAndGetWiderMatch (
                     continue;
         }   }   }
 
-        {   U32 const distNextMatch = DELTANEXTU16(chainTable, matchIndex);
+        {   U32 const distNextMatch = DELTANEXT(chainTable, chainMask, matchIndex);
             if (patternAnalysis && distNextMatch==1 && matchChainPos==0) {
                 U32 const matchCandidateIdx = matchIndex-1;
                 /* may be a repeated pattern */
@@ -1043,14 +1154,14 @@ LZ4HC_InsertAndGetWiderMatch (
                                         size_t const maxML = MIN(currentSegmentLength, srcPatternLength);
                                         if ((size_t)longest < maxML) {
                                             assert(prefixPtr - prefixIdx + matchIndex != ip);
-                                            if ((size_t)(ip - prefixPtr) + prefixIdx - matchIndex > LZ4_DISTANCE_MAX) break;
+                                            if ((size_t)(ip - prefixPtr) + prefixIdx - matchIndex > maxDistance) break;
                                             assert(maxML < 2 GB);
                                             longest = (int)maxML;
                                             offset = (int)(ipIndex - matchIndex);
                                             assert(sBack == 0);
                                             DEBUGLOG(7, "Found repeat pattern match of len=%i, offset=%i", longest, offset);
                                         }
-                                        {   U32 const distToNextPattern = DELTANEXTU16(chainTable, matchIndex);
+                                        {   U32 const distToNextPattern = DELTANEXT(chainTable, chainMask, matchIndex);
                                             if (distToNextPattern > matchIndex) break;  /* avoid overflow */
                                             matchIndex -= distToNextPattern;
                         }   }   }   }   }
@@ -1059,7 +1170,7 @@ LZ4HC_InsertAndGetWiderMatch (
         }   }   /* PA optimization */
 
         /* follow current chain */
-        matchIndex -= DELTANEXTU16(chainTable, matchIndex + matchChainPos);
+        matchIndex -= DELTANEXT(chainTable, chainMask, matchIndex + matchChainPos);
 
     }  /* while ((matchIndex>=lowestMatchIndex) && (nbAttempts)) */
 
@@ -1067,11 +1178,17 @@ LZ4HC_InsertAndGetWiderMatch (
       && nbAttempts > 0
       && withinStartDistance) {
         size_t const dictEndOffset = (size_t)(dictCtx->end - dictCtx->prefixStart) + dictCtx->dictLimit;
-        U32 dictMatchIndex = dictCtx->hashTable[LZ4HC_hashPtr(ip)];
+        U32 const dictHashLog = LZ4HC_hashLog(dictCtx, customTables);
+        U32 const dictChainLog = LZ4HC_chainLog(dictCtx, customTables);
+        const U32* const dictHashTable = dictCtx->hashTable;   /* may be larger than declared array */
+        const U16* const dictChainTable = LZ4HC_chainTableConst(dictCtx, dictHashLog);
+        U32 const dictChainMask = (1U << dictChainLog) - 1;
+        U32 const dictMaxDistance = LZ4HC_maxDistance(dictChainLog);
+        U32 dictMatchIndex = dictHashTable[LZ4HC_hashPtrLog(ip, dictHashLog)];
         assert(dictEndOffset <= 1 GB);
         matchIndex = dictMatchIndex + lowestMatchIndex - (U32)dictEndOffset;
         if (dictMatchIndex>0) DEBUGLOG(7, "dictEndOffset = %zu, dictMatchIndex = %u => relative matchIndex = %i", dictEndOffset, dictMatchIndex, (int)dictMatchIndex - (int)dictEndOffset);
-        while (ipIndex - matchIndex <= LZ4_DISTANCE_MAX && nbAttempts--) {
+        while (ipIndex - matchIndex <= dictMaxDistance && nbAttempts--) {
             const BYTE* const matchPtr = dictCtx->prefixStart - dictCtx->dictLimit + dictMatchIndex;
 
             if (LZ4_read32(matchPtr) == pattern) {
@@ -1089,11 +1206,13 @@ LZ4HC_InsertAndGetWiderMatch (
                     DEBUGLOG(7, "found match of length %i within extDictCtx", longest);
             }   }
 
-            {   U32 const nextOffset = DELTANEXTU16(dictCtx->chainTable, dictMatchIndex);
+            {   U32 const nextOffset = DELTANEXT(dictChainTable, dictChainMask, dictMatchIndex);
                 dictMatchIndex -= nextOffset;
                 matchIndex -= nextOffset;
     }   }   }
 
+    if (nbAttemptsPtr != NULL) *nbAttemptsPtr += (size_t)(maxNbAttempts - MAX(nbAttempts, 0));
+
     {   LZ4HC_match_t md;
         assert(longest >= 0);
         md.len = longest;
@@ -1108,13 +1227,14 @@ LZ4HC_InsertAndFindBestMatch(LZ4HC_CCtx_internal* const hc4,   /* Index table wi
                        const BYTE* const ip, const BYTE* const iLimit,
                        const int maxNbAttempts,
                        const int patternAnalysis,
-                       const dictCtx_directive dict)
+                       const dictCtx_directive dict,
+                       const tableSize_directive tables)
 {
     DEBUGLOG(7, "LZ4HC_InsertAndFindBestMatch");
     /* note : LZ4HC_InsertAndGetWiderMatch() is able to modify the starting position of a match (*startpos),
      * but this won't be the case here, as we define iLowLimit==ip,
      * so LZ4HC_InsertAndGetWiderMatch() won't be allowed to search past ip */
-    return LZ4HC_InsertAndGetWiderMatch(hc4, ip, ip, iLimit, MINMATCH-1, maxNbAttempts, patternAnalysis, 0 /*chainSwap*/, dict, favorCompressionRatio);
+    return LZ4HC_InsertAndGetWiderMatch(hc4, ip, ip, iLimit, MINMATCH-1, maxNbAttempts, patternAnalysis, 0 /*chainSwap*/, dict, tables, favorCompressionRatio, NULL);
 }
 
 
@@ -1126,7 +1246,8 @@ LZ4_FORCE_INLINE int LZ4HC_compress_hashChain (
     int const maxOutputSize,
     int maxNbAttempts,
     const limitedOutput_directive limit,
-    const dictCtx_directive dict
+    const dictCtx_directive dict,
+    const tableSize_directive tables
     )
 {
     const int inputSize = *srcSizePtr;
@@ -1156,7 +1277,7 @@ LZ4_FORCE_INLINE int LZ4HC_compress_hashChain (
 
     /* Main Loop */
     while (ip <= mflimit) {
-        m1 = LZ4HC_InsertAndFindBestMatch(ctx, ip, matchlimit, maxNbAttempts, patternAnalysis, dict);
+        m1 = LZ4HC_InsertAndFindBestMatch(ctx, ip, matchlimit, maxNbAttempts, patternAnalysis, dict, tables);
         if (m1.len<MINMATCH) { ip++; continue; }
 
         /* saved, in case we would skip too much */
@@ -1168,7 +1289,7 @@ _Search2:
             start2 = ip + m1.len - 2;
             m2 = LZ4HC_InsertAndGetWiderMatch(ctx,
                             start2, ip + 0, matchlimit, m1.len,
-                            maxNbAttempts, patternAnalysis, 0, dict, favorCompressionRatio);
+                            maxNbAttempts, patternAnalysis, 0, dict, tables, favorCompressionRatio, NULL);
             start2 += m2.back;
         } else {
             m2 = nomatch;  /* do not search further */
@@ -1213,7 +1334,7 @@ _Search3:
             start3 = start2 + m2.len - 3;
             m3 = LZ4HC_InsertAndGetWiderMatch(ctx,
                             start3, start2, matchlimit, m2.len,
-                            maxNbAttempts, patternAnalysis, 0, dict, favorCompressionRatio);
+                            maxNbAttempts, patternAnalysis, 0, dict, tables, favorCompressionRatio, NULL);
             start3 += m3.back;
         } else {
             m3 = nomatch;  /* do not search further */
@@ -1367,6 +1488,7 @@ static int LZ4HC_compress_optimal( LZ4HC_CCtx_internal* ctx,
     int* srcSizePtr, int dstCapacity,
     int const nbSearches, size_t sufficient_len,
     const limitedOutput_directive limit, int const fullUpdate,
+    int const useBinaryTree,
     const dictCtx_directive dict,
     const HCfavor_e favorDecSpeed);
 
@@ -1377,7 +1499,7 @@ LZ4HC_compress_generic_internal (
             char* const dst,
             int* const srcSizePtr,
             int const dstCapacity,
-            int cLevel,
+            cParams_t const cParam,
             const limitedOutput_directive limit,
             const dictCtx_directive dict
             )
@@ -1389,8 +1511,7 @@ LZ4HC_compress_generic_internal (
     if ((U32)*srcSizePtr > (U32)LZ4_MAX_INPUT_SIZE) return 0;  /* Unsupported input size (too large or negative) */
 
     ctx->end += *srcSizePtr;
-    {   cParams_t const cParam = LZ4HC_getCLevelParams(cLevel);
-        HCfavor_e const favor = ctx->favorDecSpeed ? favorDecompressionSpeed : favorCompressionRatio;
+    {   HCfavor_e const favor = ctx->favorDecSpeed ? favorDecompressionSpeed : favorCompressionRatio;
         int result;
 
         if (cParam.strat == lz4mid) {
@@ -1398,15 +1519,21 @@ LZ4HC_compress_generic_internal (
                                 src, dst, srcSizePtr, dstCapacity,
                                 limit, dict);
         } else if (cParam.strat == lz4hc) {
-            result = LZ4HC_compress_hashChain(ctx,
+            if (ctx->tableLogs == 0)
+                result = LZ4HC_compress_hashChain(ctx,
                                 src, dst, srcSizePtr, dstCapacity,
-                                cParam.nbSearches, limit, dict);
+                                cParam.nbSearches, limit, dict, defaultTables);
+            else
+                result = LZ4HC_compress_hashChain(ctx,
+                                src, dst, srcSizePtr, dstCapacity,
+                                cParam.nbSearches, limit, dict, customTables);
         } else {
-            assert(cParam.strat == lz4opt);
+            assert(cParam.strat == lz4opt || cParam.strat == lz4btopt);
             result = LZ4HC_compress_optimal(ctx,
                                 src, dst, srcSizePtr, dstCapacity,
                                 cParam.nbSearches, cParam.targetLength, limit,
-                                cLevel >= LZ4HC_CLEVEL_MAX,   /* ultra mode */
+                                cParam.targetLength >= LZ4_OPT_NUM,   /* ultra mode */
+                                cParam.strat == lz4btopt,
                                 dict, favor);
         }
         if (result <= 0) ctx->dirty = 1;
@@ -1423,19 +1550,19 @@ LZ4HC_compress_generic_noDictCtx (
         char* const dst,
         int* const srcSizePtr,
         int const dstCapacity,
-        int cLevel,
+        cParams_t const cParam,
         limitedOutput_directive limit
         )
 {
     assert(ctx->dictCtx == NULL);
-    return LZ4HC_compress_generic_internal(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit, noDictCtx);
+    return LZ4HC_compress_generic_internal(ctx, src, dst, srcSizePtr, dstCapacity, cParam, limit, noDictCtx);
 }
 
-static int isStateCompatible(const LZ4HC_CCtx_internal* ctx1, const LZ4HC_CCtx_internal* ctx2)
+static int isStateCompatible(const LZ4HC_CCtx_internal* ctx1, lz4hc_strat_e strat1, const LZ4HC_CCtx_internal* ctx2)
 {
-    int const isMid1 = LZ4HC_getCLevelParams(ctx1->compressionLevel).strat == lz4mid;
+    int const isMid1 = strat1 == lz4mid;
     int const isMid2 = LZ4HC_getCLevelParams(ctx2->compressionLevel).strat == lz4mid;
-    return !(isMid1 ^ isMid2);
+    return !(isMid1 ^ isMid2) && (ctx1->tableLogs == ctx2->tableLogs);
 }
 
 static int
@@ -1445,7 +1572,7 @@ LZ4HC_compress_generic_dictCtx (
         char* const dst,
         int* const srcSizePtr,
         int const dstCapacity,
-        int cLevel,
+        cParams_t const cParam,
         limitedOutput_directive limit
         )
 {
@@ -1453,14 +1580,15 @@ LZ4HC_compress_generic_dictCtx (
     assert(ctx->dictCtx != NULL);
     if (position >= 64 KB) {
         ctx->dictCtx = NULL;
-        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit);
-    } else if (position == 0 && *srcSizePtr > 4 KB && isStateCompatible(ctx, ctx->dictCtx)) {
-        LZ4_memcpy(ctx, ctx->dictCtx, sizeof(LZ4HC_CCtx_internal));
+        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cParam, limit);
+    } else if (position == 0 && *srcSizePtr > 4 KB && isStateCompatible(ctx, cParam.strat, ctx->dictCtx)) {
+        LZ4_i8 const cLevel = ctx->compressionLevel;
+        LZ4_memcpy(ctx, ctx->dictCtx, LZ4HC_stateSize(LZ4HC_hashLog(ctx, customTables), LZ4HC_chainLog(ctx, customTables)));
         LZ4HC_setExternalDict(ctx, (const BYTE *)src);
-        ctx->compressionLevel = (short)cLevel;
-        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit);
+        ctx->compressionLevel = cLevel;
+        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cParam, limit);
     } else {
-        return LZ4HC_compress_generic_internal(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit, usingDictCtxHc);
+        return LZ4HC_compress_generic_internal(ctx, src, dst, srcSizePtr, dstCapacity, cParam, limit, usingDictCtxHc);
     }
 }
 
@@ -1471,14 +1599,14 @@ LZ4HC_compress_generic (
         char* const dst,
         int* const srcSizePtr,
         int const dstCapacity,
-        int cLevel,
+        cParams_t const cParam,
         limitedOutput_directive limit
         )
 {
     if (ctx->dictCtx == NULL) {
-        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit);
+        return LZ4HC_compress_generic_noDictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cParam, limit);
     } else {
-        return LZ4HC_compress_generic_dictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cLevel, limit);
+        return LZ4HC_compress_generic_dictCtx(ctx, src, dst, srcSizePtr, dstCapacity, cParam, limit);
     }
 }
 
@@ -1504,9 +1632,9 @@ int LZ4_compress_HC_extStateHC_fastReset (void* state, const char* src, char* ds
     LZ4_resetStreamHC_fast((LZ4_streamHC_t*)state, compressionLevel);
     LZ4HC_init_internal (ctx, (const BYTE*)src);
     if (dstCapacity < LZ4_compressBound(srcSize))
-        return LZ4HC_compress_generic (ctx, src, dst, &srcSize, dstCapacity, compressionLevel, limitedOutput);
+        return LZ4HC_compress_generic (ctx, src, dst, &srcSize, dstCapacity, LZ4HC_getCLevelParams(compressionLevel), limitedOutput);
     else
-        return LZ4HC_compress_generic (ctx, src, dst, &srcSize, dstCapacity, compressionLevel, notLimited);
+        return LZ4HC_compress_generic (ctx, src, dst, &srcSize, dstCapacity, LZ4HC_getCLevelParams(compressionLevel), notLimited);
 }
 
 int LZ4_compress_HC_extStateHC (void* state, const char* src, char* dst, int srcSize, int dstCapacity, int compressionLevel)
@@ -1516,6 +1644,24 @@ int LZ4_compress_HC_extStateHC (void* state, const char* src, char* dst, int src
     return LZ4_compress_HC_extStateHC_fastReset(state, src, dst, srcSize, dstCapacity, compressionLevel);
 }
 
+/* state is presumed correctly initialized, by LZ4_initStreamHC() or LZ4_initStreamHC_advanced(),
+ * so that its table sizes can be preserved */
+int LZ4_compress_HC_extStateHC_advanced (void* state, const char* src, char* dst, int srcSize, int dstCapacity, const LZ4HC_cParams_t* cParams)
+{
+    LZ4_streamHC_t* const ctx = (LZ4_streamHC_t*)state;
+    cParams_t cParam;
+    if (!LZ4_isAligned(state, LZ4_streamHC_t_alignment())) return 0;
+    if (!LZ4HC_importCParams(&cParam, cParams)) return 0;
+    LZ4HC_resetState(&ctx->internal_donotuse);
+    /* stream level only decides how history is indexed : pick one of the same family */
+    LZ4_setCompressionLevel(ctx, (cParam.strat == lz4mid) ? LZ4HC_CLEVEL_MIN : LZ4HC_CLEVEL_DEFAULT);
+    LZ4HC_init_internal (&ctx->internal_donotuse, (const BYTE*)src);
+    if (dstCapacity < LZ4_compressBound(srcSize))
+        return LZ4HC_compress_generic (&ctx->internal_donotuse, src, dst, &srcSize, dstCapacity, cParam, limitedOutput);
+    else
+        return LZ4HC_compress_generic (&ctx->internal_donotuse, src, dst, &srcSize, dstCapacity, cParam, notLimited);
+}
+
 int LZ4_compress_HC(const char* src, char* dst, int srcSize, int dstCapacity, int compressionLevel)
 {
     int cSize;
@@ -1541,7 +1687,7 @@ int LZ4_compress_HC_destSize(void* state, const char* source, char* dest, int* s
     if (ctx==NULL) return 0;   /* init failure */
     LZ4HC_init_internal(&ctx->internal_donotuse, (const BYTE*) source);
     LZ4_setCompressionLevel(ctx, cLevel);
-    return LZ4HC_compress_generic(&ctx->internal_donotuse, source, dest, sourceSizePtr, targetDestSize, cLevel, fillOutput);
+    return LZ4HC_compress_generic(&ctx->internal_donotuse, source, dest, sourceSizePtr, targetDestSize, LZ4HC_getCLevelParams(cLevel), fillOutput);
 }
 
 
@@ -1570,6 +1716,29 @@ int LZ4_freeStreamHC (LZ4_streamHC_t* LZ4_streamHCPtr)
 #endif
 
 
+LZ4_streamHC_t* LZ4_createStreamHC_advanced(LZ4_CustomMem cmem, int hashLog, int chainLog)
+{
+    int const stateSize = LZ4_sizeofStateHC_advanced(hashLog, chainLog);
+    void* buffer;
+    LZ4_streamHC_t* state;
+    if (stateSize == 0) return NULL;   /* invalid parameters */
+    buffer = LZ4_customAlloc((size_t)stateSize, cmem);
+    DEBUGLOG(4, "LZ4_createStreamHC_advanced(%p, hashLog=%i, chainLog=%i)", buffer, hashLog, chainLog);
+    if (buffer == NULL) return NULL;
+    state = LZ4_initStreamHC_advanced(buffer, (size_t)stateSize, hashLog, chainLog);
+    if (state == NULL) {   /* custom allocator returned insufficiently aligned memory */
+        LZ4_customFree(buffer, (size_t)stateSize, cmem);
+        return NULL;
+    }
+    return state;
+}
+
+void LZ4_freeStreamHC_advanced(LZ4_streamHC_t* LZ4_streamHCPtr, LZ4_CustomMem cmem, int hashLog, int chainLog)
+{
+    DEBUGLOG(4, "LZ4_freeStreamHC_advanced(%p)", LZ4_streamHCPtr);
+    LZ4_customFree(LZ4_streamHCPtr, (size_t)LZ4_sizeofStateHC_advanced(hashLog, chainLog), cmem);
+}
+
 LZ4_streamHC_t* LZ4_initStreamHC (void* buffer, size_t size)
 {
     LZ4_streamHC_t* const LZ4_streamHCPtr = (LZ4_streamHC_t*)buffer;
@@ -1579,12 +1748,42 @@ LZ4_streamHC_t* LZ4_initStreamHC (void* buffer, size_t size)
     if (size < sizeof(LZ4_streamHC_t)) return NULL;
     if (!LZ4_isAligned(buffer, LZ4_streamHC_t_alignment())) return NULL;
     /* init */
+    LZ4_STATIC_ASSERT(sizeof(LZ4HC_CCtx_internal) <= LZ4_STREAMHC_MINSIZE);
+    LZ4_STATIC_ASSERT(offsetof(LZ4HC_CCtx_internal, chainTable) == offsetof(LZ4HC_CCtx_internal, hashTable) + sizeof(U32) * LZ4HC_HASHTABLESIZE);   /* see LZ4HC_chainTable() */
     { LZ4HC_CCtx_internal* const hcstate = &(LZ4_streamHCPtr->internal_donotuse);
       MEM_INIT(hcstate, 0, sizeof(*hcstate)); }
     LZ4_setCompressionLevel(LZ4_streamHCPtr, LZ4HC_CLEVEL_DEFAULT);
     return LZ4_streamHCPtr;
 }
 
+int LZ4_sizeofStateHC_advanced(int hashLog, int chainLog)
+{
+    if (hashLog == 0) hashLog = LZ4HC_HASH_LOG;
+    if (chainLog == 0) chainLog = LZ4HC_DICTIONARY_LOGSIZE;
+    if ((hashLog < LZ4HC_HASHLOG_MIN) || (hashLog > LZ4HC_HASHLOG_MAX)) return 0;
+    if ((chainLog < LZ4HC_CHAINLOG_MIN) || (chainLog > LZ4HC_CHAINLOG_MAX)) return 0;
+    if ((hashLog == LZ4HC_HASH_LOG) && (chainLog == LZ4HC_DICTIONARY_LOGSIZE)) return LZ4_sizeofStateHC();
+    return (int)LZ4HC_stateSize((U32)hashLog, (U32)chainLog);
+}
+
+LZ4_streamHC_t* LZ4_initStreamHC_advanced(void* buffer, size_t size, int hashLog, int chainLog)
+{
+    int const stateSize = LZ4_sizeofStateHC_advanced(hashLog, chainLog);
+    DEBUGLOG(4, "LZ4_initStreamHC_advanced(%p, %u, hashLog=%i, chainLog=%i)", buffer, (unsigned)size, hashLog, chainLog);
+    if (buffer == NULL) return NULL;
+    if (stateSize == 0) return NULL;   /* invalid parameters */
+    if (size < (size_t)stateSize) return NULL;
+    if (!LZ4_isAligned(buffer, LZ4_streamHC_t_alignment())) return NULL;
+    if (hashLog == 0) hashLog = LZ4HC_HASH_LOG;
+    if (chainLog == 0) chainLog = LZ4HC_DICTIONARY_LOGSIZE;
+    {   LZ4HC_CCtx_internal* const hcstate = &((LZ4_streamHC_t*)buffer)->internal_donotuse;
+        MEM_INIT(hcstate, 0, LZ4HC_stateSize((U32)hashLog, (U32)chainLog));
+        hcstate->tableLogs = LZ4HC_tableLogs((U32)hashLog, (U32)chainLog);
+    }
+    LZ4_setCompressionLevel((LZ4_streamHC_t*)buffer, LZ4HC_CLEVEL_DEFAULT);
+    return (LZ4_streamHC_t*)buffer;
+}
+
 /* just a stub */
 void LZ4_resetStreamHC (LZ4_streamHC_t* LZ4_streamHCPtr, int compressionLevel)
 {
@@ -1597,7 +1796,7 @@ void LZ4_resetStreamHC_fast (LZ4_streamHC_t* LZ4_streamHCPtr, int compressionLev
     LZ4HC_CCtx_internal* const s = &LZ4_streamHCPtr->internal_donotuse;
     DEBUGLOG(5, "LZ4_resetStreamHC_fast(%p, %d)", LZ4_streamHCPtr, compressionLevel);
     if (s->dirty) {
-        LZ4_initStreamHC(LZ4_streamHCPtr, sizeof(*LZ4_streamHCPtr));
+        LZ4HC_resetState(s);
     } else {
         assert(s->end >= s->prefixStart);
         s->dictLimit += (U32)(s->end - s->prefixStart);
@@ -1613,7 +1812,7 @@ void LZ4_setCompressionLevel(LZ4_streamHC_t* LZ4_streamHCPtr, int compressionLev
     DEBUGLOG(5, "LZ4_setCompressionLevel(%p, %d)", LZ4_streamHCPtr, compressionLevel);
     if (compressionLevel < 1) compressionLevel = LZ4HC_CLEVEL_DEFAULT;
     if (compressionLevel > LZ4HC_CLEVEL_MAX) compressionLevel = LZ4HC_CLEVEL_MAX;
-    LZ4_streamHCPtr->internal_donotuse.compressionLevel = (short)compressionLevel;
+    LZ4_streamHCPtr->internal_donotuse.compressionLevel = (LZ4_i8)compressionLevel;
 }
 
 void LZ4_favorDecompressionSpeed(LZ4_streamHC_t* LZ4_streamHCPtr, int favor)
@@ -1637,7 +1836,7 @@ int LZ4_loadDictHC (LZ4_streamHC_t* LZ4_streamHCPtr,
     }
     /* need a full initialization, there are bad side-effects when using resetFast() */
     {   int const cLevel = ctxPtr->compressionLevel;
-        LZ4_initStreamHC(LZ4_streamHCPtr, sizeof(*LZ4_streamHCPtr));
+        LZ4HC_resetState(ctxPtr);
         LZ4_setCompressionLevel(LZ4_streamHCPtr, cLevel);
         cp = LZ4HC_getCLevelParams(cLevel);
     }
@@ -1646,7 +1845,7 @@ int LZ4_loadDictHC (LZ4_streamHC_t* LZ4_streamHCPtr,
     if (cp.strat == lz4mid) {
         LZ4MID_fillHTable (ctxPtr, dictionary, (size_t)dictSize);
     } else {
-        if (dictSize >= LZ4HC_HASHSIZE) LZ4HC_Insert (ctxPtr, ctxPtr->end-3);
+        if (dictSize >= LZ4HC_HASHSIZE) LZ4HC_Insert (ctxPtr, ctxPtr->end-3, customTables);
     }
     return dictSize;
 }
@@ -1662,7 +1861,7 @@ static void LZ4HC_setExternalDict(LZ4HC_CCtx_internal* ctxPtr, const BYTE* newBl
     DEBUGLOG(4, "LZ4HC_setExternalDict(%p, %p)", ctxPtr, newBlock);
     if ( (ctxPtr->end >= ctxPtr->prefixStart + 4)
       && (LZ4HC_getCLevelParams(ctxPtr->compressionLevel).strat != lz4mid) ) {
-        LZ4HC_Insert (ctxPtr, ctxPtr->end-3);  /* Referencing remaining dictionary content */
+        LZ4HC_Insert (ctxPtr, ctxPtr->end-3, customTables);  /* Referencing remaining dictionary content */
     }
 
     /* Only one memory segment for extDict, so any previous extDict is lost at this stage */
@@ -1681,6 +1880,7 @@ static int
 LZ4_compressHC_continue_generic (LZ4_streamHC_t* LZ4_streamHCPtr,
                                  const char* src, char* dst,
                                  int* srcSizePtr, int dstCapacity,
+                                 cParams_t const cParam,
                                  limitedOutput_directive limit)
 {
     LZ4HC_CCtx_internal* const ctxPtr = &LZ4_streamHCPtr->internal_donotuse;
@@ -1716,21 +1916,34 @@ LZ4_compressHC_continue_generic (LZ4_streamHC_t* LZ4_streamHCPtr,
                 ctxPtr->dictStart = ctxPtr->prefixStart;
     }   }   }
 
-    return LZ4HC_compress_generic (ctxPtr, src, dst, srcSizePtr, dstCapacity, ctxPtr->compressionLevel, limit);
+    return LZ4HC_compress_generic (ctxPtr, src, dst, srcSizePtr, dstCapacity, cParam, limit);
 }
 
 int LZ4_compress_HC_continue (LZ4_streamHC_t* LZ4_streamHCPtr, const char* src, char* dst, int srcSize, int dstCapacity)
 {
+    cParams_t const cParam = LZ4HC_getCLevelParams(LZ4_streamHCPtr->internal_donotuse.compressionLevel);
     DEBUGLOG(5, "LZ4_compress_HC_continue");
     if (dstCapacity < LZ4_compressBound(srcSize))
-        return LZ4_compressHC_continue_generic (LZ4_streamHCPtr, src, dst, &srcSize, dstCapacity, limitedOutput);
+        return LZ4_compressHC_continue_generic (LZ4_streamHCPtr, src, dst, &srcSize, dstCapacity, cParam, limitedOutput);
+    else
+        return LZ4_compressHC_continue_generic (LZ4_streamHCPtr, src, dst, &srcSize, dstCapacity, cParam, notLimited);
+}
+
+int LZ4_compress_HC_continue_advanced (LZ4_streamHC_t* LZ4_streamHCPtr, const char* src, char* dst, int srcSize, int dstCapacity, const LZ4HC_cParams_t* cParams)
+{
+    cParams_t cParam;
+    DEBUGLOG(5, "LZ4_compress_HC_continue_advanced");
+    if (!LZ4HC_importCParams(&cParam, cParams)) return 0;
+    if (dstCapacity < LZ4_compressBound(srcSize))
+        return LZ4_compressHC_continue_generic (LZ4_streamHCPtr, src, dst, &srcSize, dstCapacity, cParam, limitedOutput);
     else
-        return LZ4_compressHC_continue_generic (LZ4_streamHCPtr, src, dst, &srcSize, dstCapacity, notLimited);
+        return LZ4_compressHC_continue_generic (LZ4_streamHCPtr, src, dst, &srcSize, dstCapacity, cParam, notLimited);
 }
 
 int LZ4_compress_HC_continue_destSize (LZ4_streamHC_t* LZ4_streamHCPtr, const char* src, char* dst, int* srcSizePtr, int targetDestSize)
 {
-    return LZ4_compressHC_continue_generic(LZ4_streamHCPtr, src, dst, srcSizePtr, targetDestSize, fillOutput);
+    cParams_t const cParam = LZ4HC_getCLevelParams(LZ4_streamHCPtr->internal_donotuse.compressionLevel);
+    return LZ4_compressHC_continue_generic(LZ4_streamHCPtr, src, dst, srcSizePtr, targetDestSize, cParam, fillOutput);
 }
 
 
@@ -1799,18 +2012,198 @@ LZ4_FORCE_INLINE int LZ4HC_sequencePrice(int litlen, int mlen)
     return price;
 }
 
+/*===   Binary tree match finder (lz4btopt)   ===*/
+/* Positions sharing a hash are sorted into a binary tree,
+ * in lexicographic order of the strings they start.
+ * Searching the longest match then visits O(log n) nodes, inserting current position on the way,
+ * instead of walking a whole hash chain.
+ * The tree doesn't fit into LZ4_streamHC_t, so it lives in a workspace allocated for the duration
+ * of a compression call, and is seeded with history (up to 64 KB) preceding the position where it takes over.
+ * Children of a node are always older than their parent,
+ * so descent stops as soon as a node falls out of the window. */
+#define LZ4HC_BT_KEEP 32
+typedef struct {
+    U32 hashTable[LZ4HC_HASHTABLESIZE];
+    U32 tree[2 * LZ4HC_MAXD];   /* smaller and larger child of each position within window */
+    U32 nextToUpdate;           /* index from which to continue tree update */
+} LZ4HC_bt_t;
+
+static U32 LZ4HC_bt_lowestIndex(const LZ4HC_CCtx_internal* ctx, U32 idx)
+{
+    return (ctx->lowLimit + LZ4_DISTANCE_MAX > idx) ? ctx->lowLimit : idx - LZ4_DISTANCE_MAX;
+}
+
+static const BYTE* LZ4HC_bt_ptr(const LZ4HC_CCtx_internal* ctx, U32 idx)
+{
+    return (idx >= ctx->dictLimit) ? ctx->prefixStart + (idx - ctx->dictLimit)
+                                   : ctx->dictStart + (idx - ctx->lowLimit);
+}
+
+/* LZ4HC_bt_count() :
+ * @return : length of the common prefix of strings starting at @cur and @match (match < cur),
+ *           knowing their first @len bytes are identical, and not going beyond @endIdx.
+ *  Both strings may start within extDict and continue into prefix. */
+static U32 LZ4HC_bt_count(const LZ4HC_CCtx_internal* ctx, U32 cur, U32 match, U32 len, U32 endIdx)
+{
+    U32 const prefixIdx = ctx->dictLimit;
+    assert(match < cur);
+    while (cur + len < endIdx) {
+        U32 const c = cur + len;
+        U32 const m = match + len;
+        const BYTE* const cPtr = LZ4HC_bt_ptr(ctx, c);
+        U32 n = endIdx - c;
+        U32 k;
+        if (c < prefixIdx) n = MIN(n, prefixIdx - c);
+        if (m < prefixIdx) n = MIN(n, prefixIdx - m);
+        k = LZ4_count(cPtr, LZ4HC_bt_ptr(ctx, m), cPtr + n);
+        len += k;
+        if (k < n) break;   /* mismatch (otherwise, one string reached end of its segment) */
+    }
+    return len;
+}
+
+/* LZ4HC_bt_insertAndFind() :
+ *  Inserts position @cur into its tree, and reports the longest match met on the way,
+ *  provided it is longer than @minLen.
+ *  Strings are compared up to @endIdx, which must remain the same for a whole compression call.
+ * @skipPtr : receives nb of positions (>= 1) to move forward before next insertion. */
+static LZ4HC_match_t
+LZ4HC_bt_insertAndFind(const LZ4HC_CCtx_internal* const ctx, LZ4HC_bt_t* const bt,
+                       U32 const cur, U32 const endIdx,
+                       int const minLen, int nbCompares,
+                       U32* skipPtr)
+{
+    U32* const tree = bt->tree;
+    U32 const h = LZ4HC_hashPtr(LZ4HC_bt_ptr(ctx, cur));
+    U32 const lowestMatchIndex = LZ4HC_bt_lowestIndex(ctx, cur);
+    U32* smallerPtr = tree + 2*(cur & LZ4HC_MAXD_MASK);
+    U32* largerPtr  = smallerPtr + 1;
+    U32 matchIndex = bt->hashTable[h];
+    U32 commonLengthSmaller = 0, commonLengthLarger = 0;
+    U32 bestLength = 0;
+    U32 matchEndIdx = cur;   /* end of the farthest reaching match : beyond cur within a repetition */
+    LZ4HC_match_t md = { 0, 0, 0 };
+
+    assert(cur + MINMATCH <= endIdx);
+    bt->hashTable[h] = cur;
+
+    while ((matchIndex >= lowestMatchIndex) && (nbCompares-- > 0)) {
+        U32* const nextPtr = tree + 2*(matchIndex & LZ4HC_MAXD_MASK);
+        U32 const matchLength = LZ4HC_bt_count(ctx, cur, matchIndex,
+                                    MIN(commonLengthSmaller, commonLengthLarger), endIdx);
+        assert(matchIndex < cur);
+
+        if (matchLength > bestLength) {
+            bestLength = matchLength;
+            if (((int)matchLength > minLen) && (matchLength >= MINMATCH)) {
+                md.len = (int)matchLength;
+                md.off = (int)(cur - matchIndex);
+        }   }
+        if (matchIndex + matchLength > matchEndIdx) matchEndIdx = matchIndex + matchLength;
+
+        if (cur + matchLength == endIdx)
+            break;   /* strings can't be ordered : drop remaining nodes, to preserve tree consistency */
+
+        if (*LZ4HC_bt_ptr(ctx, matchIndex + matchLength) < *LZ4HC_bt_ptr(ctx, cur + matchLength)) {
+            /* match is smaller than current */
+            *smallerPtr = matchIndex;
+            commonLengthSmaller = matchLength;
+            smallerPtr = nextPtr + 1;   /* new "smaller" slot : larger child of match */
+            matchIndex = nextPtr[1];
+        } else {
+            /* match is larger than current */
+            *largerPtr = matchIndex;
+            commonLengthLarger = matchLength;
+            largerPtr = nextPtr;        /* new "larger" slot : smaller child of match */
+            matchIndex = nextPtr[0];
+    }   }
+    *smallerPtr = *largerPtr = 0;   /* index 0 is never within window */
+
+    /* Positions within a repetition (such as a run of identical bytes) would form a long list,
+     * which gets truncated by nbCompares, losing older history : only insert its last LZ4HC_BT_KEEP positions.
+     * Positions within a very long match are not worth inserting either :
+     * each would cost a full comparison, for matches the parser encodes immediately anyway. */
+    {   U32 skip = (bestLength > LZ4_OPT_NUM) ? bestLength - LZ4_OPT_NUM : 1;
+        if (matchEndIdx > cur + LZ4HC_BT_KEEP)
+            skip = MAX(skip, matchEndIdx - (cur + LZ4HC_BT_KEEP));
+        *skipPtr = skip;
+    }
+    return md;
+}
+
+/* LZ4HC_bt_update() :
+ * Inserts all positions from bt->nextToUpdate up to @target (excluded) */
+static void LZ4HC_bt_update(const LZ4HC_CCtx_internal* ctx, LZ4HC_bt_t* bt,
+                            U32 const target, U32 const endIdx, int const nbCompares)
+{
+    U32 const prefixIdx = ctx->dictLimit;
+    U32 idx = bt->nextToUpdate;
+    while (idx < target) {
+        U32 skip;
+        if ((idx < prefixIdx) && (idx + MINMATCH > prefixIdx)) {
+            idx = prefixIdx;   /* last bytes of extDict : can't hash without straddling segments */
+            continue;
+        }
+        (void)LZ4HC_bt_insertAndFind(ctx, bt, idx, endIdx, INT_MAX, nbCompares, &skip);
+        idx += skip;
+    }
+    bt->nextToUpdate = idx;
+}
+
+/* LZ4HC_bt_init() :
+ *  Prepares @bt to reference history from @historyIdx, which will be inserted lazily */
+static void LZ4HC_bt_init(LZ4HC_bt_t* bt, U32 historyIdx)
+{
+    MEM_INIT(bt->hashTable, 0, sizeof(bt->hashTable));
+    bt->nextToUpdate = historyIdx;
+}
+
+/* The tree searches nearly every position it inserts,
+ * while hash chain only searches positions selected by the parser.
+ * It's therefore slower, unless chains get long, as in text or binaries.
+ * Compression starts with hash chain, which counts its attempts,
+ * and switches to the tree once they average LZ4HC_BT_ATTEMPTS_MIN per input byte,
+ * checked every LZ4HC_BT_PROBE bytes. */
+#define LZ4HC_BT_PROBE        (64 KB)
+#define LZ4HC_BT_ATTEMPTS_MIN 8
+
+LZ4_FORCE_INLINE LZ4HC_match_t
+LZ4HC_bt_findLongerMatch(const LZ4HC_CCtx_internal* const ctx, LZ4HC_bt_t* const bt,
+                         const BYTE* ip, const BYTE* const iHighLimit,
+                         int minLen, int nbSearches)
+{
+    U32 const ipIndex = (U32)(ip - ctx->prefixStart) + ctx->dictLimit;
+    U32 const endIdx = (U32)(iHighLimit - ctx->prefixStart) + ctx->dictLimit;
+    U32 skip;
+    LZ4HC_match_t md;
+    LZ4HC_bt_update(ctx, bt, ipIndex, endIdx, nbSearches);
+    /* ipIndex may lie within a skipped repetition, but all inserted positions precede it,
+     * since searches happen at increasing positions : it can still be inserted */
+    md = LZ4HC_bt_insertAndFind(ctx, bt, ipIndex, endIdx, minLen, nbSearches, &skip);
+    if (ipIndex + skip > bt->nextToUpdate) bt->nextToUpdate = ipIndex + skip;
+    return md;
+}
+
 LZ4_FORCE_INLINE LZ4HC_match_t
 LZ4HC_FindLongerMatch(LZ4HC_CCtx_internal* const ctx,
+                      LZ4HC_bt_t* const bt,
                       const BYTE* ip, const BYTE* const iHighLimit,
                       int minLen, int nbSearches,
                       const dictCtx_directive dict,
-                      const HCfavor_e favorDecSpeed)
+                      const HCfavor_e favorDecSpeed,
+                      size_t* nbAttemptsPtr)
 {
     LZ4HC_match_t const match0 = { 0 , 0, 0 };
-    /* note : LZ4HC_InsertAndGetWiderMatch() is able to modify the starting position of a match (*startpos),
-     * but this won't be the case here, as we define iLowLimit==ip,
-    ** so LZ4HC_InsertAndGetWiderMatch() won't be allowed to search past ip */
-    LZ4HC_match_t md = LZ4HC_InsertAndGetWiderMatch(ctx, ip, ip, iHighLimit, minLen, nbSearches, 1 /*patternAnalysis*/, 1 /*chainSwap*/, dict, favorDecSpeed);
+    LZ4HC_match_t md;
+    if (bt != NULL) {
+        assert(dict == noDictCtx && !favorDecSpeed);
+        md = LZ4HC_bt_findLongerMatch(ctx, bt, ip, iHighLimit, minLen, nbSearches);
+    } else {
+        /* note : LZ4HC_InsertAndGetWiderMatch() is able to modify the starting position of a match (*startpos),
+         * but this won't be the case here, as we define iLowLimit==ip,
+        ** so LZ4HC_InsertAndGetWiderMatch() won't be allowed to search past ip */
+        md = LZ4HC_InsertAndGetWiderMatch(ctx, ip, ip, iHighLimit, minLen, nbSearches, 1 /*patternAnalysis*/, 1 /*chainSwap*/, dict, customTables, favorDecSpeed, nbAttemptsPtr);
+    }
     assert(md.back == 0);
     if (md.len <= minLen) return match0;
     if (favorDecSpeed) {
@@ -1829,6 +2222,7 @@ static int LZ4HC_compress_optimal ( LZ4HC_CCtx_internal* ctx,
                                     size_t sufficient_len,
                                     const limitedOutput_directive limit,
                                     int const fullUpdate,
+                                    int const useBinaryTree,
                                     const dictCtx_directive dict,
                                     const HCfavor_e favorDecSpeed)
 {
@@ -1839,6 +2233,12 @@ static int LZ4HC_compress_optimal ( LZ4HC_CCtx_internal* ctx,
 #else
     LZ4HC_optimal_t opt[LZ4_OPT_NUM + TRAILING_LITERALS];   /* ~64 KB, which is a bit large for stack... */
 #endif
+    LZ4HC_bt_t* bt = NULL;   /* NULL : hash chain match finder */
+    size_t* btProbeAttemptsPtr = NULL;   /* non-NULL : counting hash chain attempts, to decide whether to switch to the tree */
+#if defined(LZ4HC_HEAPMODE) && LZ4HC_HEAPMODE==1
+    const BYTE* btProbeEnd = NULL;   /* next check */
+    size_t btProbeAttempts = 0;
+#endif
 
     const BYTE* ip = (const BYTE*) source;
     const BYTE* anchor = ip;
@@ -1859,14 +2259,45 @@ static int LZ4HC_compress_optimal ( LZ4HC_CCtx_internal* ctx,
     *srcSizePtr = 0;
     if (limit == fillOutput) oend -= LASTLITERALS;   /* Hack for support LZ4 format restriction */
     if (sufficient_len >= LZ4_OPT_NUM) sufficient_len = LZ4_OPT_NUM-1;
+#if defined(LZ4HC_HEAPMODE) && LZ4HC_HEAPMODE==1
+    /* dictCtx history is indexed by its own hash chain,
+     * and favorDecSpeed offsets >= 8 can't be reached through the tree within repetitions :
+     * both keep using hash chain. */
+    if (useBinaryTree && (dict == noDictCtx) && !favorDecSpeed) {
+        btProbeEnd = ip + MIN(LZ4HC_BT_PROBE, iend - ip);
+        btProbeAttemptsPtr = &btProbeAttempts;
+    }
+#else
+    (void)useBinaryTree;
+#endif
 
     /* Main Loop */
     while (ip <= mflimit) {
          int const llen = (int)(ip - anchor);
          int best_mlen, best_off;
          int cur, last_match_pos = 0;
+         LZ4HC_match_t firstMatch;
 
-         LZ4HC_match_t const firstMatch = LZ4HC_FindLongerMatch(ctx, ip, matchlimit, MINMATCH-1, nbSearches, dict, favorDecSpeed);
+#if defined(LZ4HC_HEAPMODE) && LZ4HC_HEAPMODE==1
+         if (unlikely(btProbeEnd != NULL) && (ip >= btProbeEnd)) {
+             /* The tree must first index history preceding ip (up to 64 KB),
+              * which isn't worth it if fewer bytes remain : keep using hash chain.
+              * Same on allocation failure. */
+             U32 const startIdx = (U32)(ip - ctx->prefixStart) + ctx->dictLimit;
+             U32 const historyIdx = LZ4HC_bt_lowestIndex(ctx, startIdx);
+             if ((size_t)(iend - ip) < startIdx - historyIdx) {
+                 btProbeEnd = NULL;
+             } else if (btProbeAttempts >= LZ4HC_BT_ATTEMPTS_MIN * (size_t)(ip - (const BYTE*)source)) {
+                 bt = (LZ4HC_bt_t*)ALLOC(sizeof(LZ4HC_bt_t));
+                 if (bt != NULL) LZ4HC_bt_init(bt, historyIdx);
+                 btProbeEnd = NULL;
+             } else {
+                 btProbeEnd = ip + MIN(LZ4HC_BT_PROBE, iend - ip);   /* check again later */
+             }
+             if (btProbeEnd == NULL) btProbeAttemptsPtr = NULL;
+         }
+#endif
+         firstMatch = LZ4HC_FindLongerMatch(ctx, bt, ip, matchlimit, MINMATCH-1, nbSearches, dict, favorDecSpeed, btProbeAttemptsPtr);
          if (firstMatch.len==0) { ip++; continue; }
 
          if ((size_t)firstMatch.len > sufficient_len) {
@@ -1938,10 +2369,10 @@ static int LZ4HC_compress_optimal ( LZ4HC_CCtx_internal* ctx,
 
              DEBUGLOG(7, "search at rPos:%u", cur);
              if (fullUpdate)
-                 newMatch = LZ4HC_FindLongerMatch(ctx, curPtr, matchlimit, MINMATCH-1, nbSearches, dict, favorDecSpeed);
+                 newMatch = LZ4HC_FindLongerMatch(ctx, bt, curPtr, matchlimit, MINMATCH-1, nbSearches, dict, favorDecSpeed, btProbeAttemptsPtr);
              else
                  /* only test matches of minimum length; slightly faster, but misses a few bytes */
-                 newMatch = LZ4HC_FindLongerMatch(ctx, curPtr, matchlimit, last_match_pos - cur, nbSearches, dict, favorDecSpeed);
+                 newMatch = LZ4HC_FindLongerMatch(ctx, bt, curPtr, matchlimit, last_match_pos - cur, nbSearches, dict, favorDecSpeed, btProbeAttemptsPtr);
              if (!newMatch.len) continue;
 
              if ( ((size_t)newMatch.len > sufficient_len)
@@ -2118,6 +2549,7 @@ if (limit == fillOutput) {
 _return_label:
 #if defined(LZ4HC_HEAPMODE) && LZ4HC_HEAPMODE==1
      if (opt) FREEMEM(opt);
+     if (bt) FREEMEM(bt);
 #endif
      return retval;
 }
@@ -2174,12 +2606,12 @@ int LZ4_freeHC (void* LZ4HC_Data)
 
 int LZ4_compressHC2_continue (void* LZ4HC_Data, const char* src, char* dst, int srcSize, int cLevel)
 {
-    return LZ4HC_compress_generic (&((LZ4_streamHC_t*)LZ4HC_Data)->internal_donotuse, src, dst, &srcSize, 0, cLevel, notLimited);
+    return LZ4HC_compress_generic (&((LZ4_streamHC_t*)LZ4HC_Data)->internal_donotuse, src, dst, &srcSize, 0, LZ4HC_getCLevelParams(cLevel), notLimited);
 }
 
 int LZ4_compressHC2_limitedOutput_continue (void* LZ4HC_Data, const char* src, char* dst, int srcSize, int dstCapacity, int cLevel)
 {
-    return LZ4HC_compress_generic (&((LZ4_streamHC_t*)LZ4HC_Data)->internal_donotuse, src, dst, &srcSize, dstCapacity, cLevel, limitedOutput);
+    return LZ4HC_compress_generic (&((LZ4_streamHC_t*)LZ4HC_Data)->internal_donotuse, src, dst, &srcSize, dstCapacity, LZ4HC_getCLevelParams(cLevel), limitedOutput);
 }
 
 char* LZ4_slideInputBufferHC(void* LZ4HC_Data)
@@ -234,19 +234,21 @@ LZ4_attach_HC_dictionary(LZ4_streamHC_t* working_stream,
 typedef struct LZ4HC_CCtx_internal LZ4HC_CCtx_internal;
 struct LZ4HC_CCtx_internal
 {
-    LZ4_u32 hashTable[LZ4HC_HASHTABLESIZE];
-    LZ4_u16 chainTable[LZ4HC_MAXD];
     const LZ4_byte* end;     /* next block here to continue on current prefix */
     const LZ4_byte* prefixStart;  /* Indexes relative to this position */
     const LZ4_byte* dictStart; /* alternate reference for extDict */
     LZ4_u32 dictLimit;       /* below that point, need extDict */
     LZ4_u32 lowLimit;        /* below that point, no more history */
     LZ4_u32 nextToUpdate;    /* index from which to continue dictionary update */
-    short   compressionLevel;
+    LZ4_i8  compressionLevel;
+    LZ4_byte tableLogs;      /* hash and chain table sizes, 0 means default (see LZ4_initStreamHC_advanced()) */
     LZ4_i8  favorDecSpeed;   /* favor decompression speed if this flag set,
                                 otherwise, favor compression ratio */
     LZ4_i8  dirty;           /* stream has to be fully reset if this flag is set */
     const LZ4HC_CCtx_internal* dictCtx;
+    /* tables must stay last : their actual size may differ from default one */
+    LZ4_u32 hashTable[LZ4HC_HASHTABLESIZE];
+    LZ4_u16 chainTable[LZ4HC_MAXD];
 };
 
 #define LZ4_STREAMHC_MINSIZE  262200  /* static size, for inter-version compatibility */
@@ -406,6 +408,109 @@ LZ4LIB_STATIC_API int LZ4_compress_HC_extStateHC_fastReset (
     int srcSize, int dstCapacity,
     int compressionLevel);
 
+/*! LZ4_createStreamHC_advanced() :
+ *  Same as LZ4_createStreamHC(), but allocates using @cmem (see LZ4_CustomMem in lz4.h),
+ *  and initializes the state like LZ4_initStreamHC_advanced(), using @hashLog and @chainLog (0 means "default").
+ *  HC states are large (~256 KB with default tables), hence benefit most from huge pages and NUMA placement.
+ * @return : NULL if a parameter is invalid, or allocation fails.
+ *  Free it with LZ4_freeStreamHC_advanced(), using the same @cmem, @hashLog and @chainLog.
+ */
+LZ4LIB_STATIC_API LZ4_streamHC_t* LZ4_createStreamHC_advanced(LZ4_CustomMem cmem, int hashLog, int chainLog);
+LZ4LIB_STATIC_API void LZ4_freeStreamHC_advanced(LZ4_streamHC_t* streamHCPtr, LZ4_CustomMem cmem, int hashLog, int chainLog);
+
+/*! LZ4_initStreamHC_advanced() :
+ *  Same as LZ4_initStreamHC(), but selects the size of hash and chain tables at runtime.
+ *  @hashLog : hash table has (1 << hashLog) cells of 4 bytes, within [LZ4HC_HASHLOG_MIN, LZ4HC_HASHLOG_MAX].
+ *  @chainLog : chain table has (1 << chainLog) cells of 2 bytes, within [LZ4HC_CHAINLOG_MIN, LZ4HC_CHAINLOG_MAX].
+ *             0 means "default", i.e. LZ4HC_HASH_LOG and LZ4HC_DICTIONARY_LOGSIZE.
+ *  Small tables (ex: 12, 12 => ~24 KB instead of ~256 KB) save memory when many states are alive,
+ *  at the cost of compression ratio, since levels 3+ then search matches within the last (1 << chainLog) bytes only.
+ *  A larger hash table (ex: hashLog 17) reduces collisions at high levels.
+ *  Once levels 11+ switch to their binary tree match finder (see LZ4HC_strat_btopt), it employs its own tables, and is not affected.
+ *  @stateBuffer must be aligned like LZ4_streamHC_t, and @size must be >= LZ4_sizeofStateHC_advanced(hashLog, chainLog).
+ * @return : pointer to the initialized state, or NULL if a condition is not respected.
+ *
+ *  The selected table sizes are honored by LZ4_resetStreamHC_fast(), LZ4_loadDictHC(), LZ4_compress_HC_continue*(),
+ *  LZ4_compress_HC_extStateHC_fastReset(), LZ4_compress_HC_extStateHC_advanced() and LZ4_saveDictHC().
+ *  Attaching a dictionary stream with different table sizes is supported.
+ *  Note : LZ4_compress_HC_extStateHC(), LZ4_compress_HC_destSize() and LZ4_resetStreamHC()
+ *         re-initialize the state with default table sizes, hence require a buffer of size >= LZ4_sizeofStateHC().
+ *         To re-initialize a state with custom table sizes, invoke LZ4_initStreamHC_advanced() again.
+ */
+#define LZ4HC_HASHLOG_MIN   10
+#define LZ4HC_HASHLOG_MAX   20
+#define LZ4HC_CHAINLOG_MIN  10
+#define LZ4HC_CHAINLOG_MAX  LZ4HC_DICTIONARY_LOGSIZE
+LZ4LIB_STATIC_API LZ4_streamHC_t* LZ4_initStreamHC_advanced(void* stateBuffer, size_t size, int hashLog, int chainLog);
+
+/*! LZ4_sizeofStateHC_advanced() :
+ * @return : minimum size of a state buffer for LZ4_initStreamHC_advanced() using @hashLog and @chainLog,
+ *           or 0 if a parameter is outside of valid range.
+ *  Note : LZ4_sizeofStateHC_advanced(0, 0) == LZ4_sizeofStateHC().
+ */
+LZ4LIB_STATIC_API int LZ4_sizeofStateHC_advanced(int hashLog, int chainLog);
+
+/*! LZ4HC_cParams_t :
+ *  Compression parameters behind each level, for tuning the speed / ratio trade-off more finely than levels do.
+ *  @strategy : match finder and parser.
+ *              LZ4HC_strat_mid : 2 hash tables, no chain (level 2). Ignores @nbSearches and @targetLength.
+ *              LZ4HC_strat_hc : hash chain, lazy parser (levels 3-9). Ignores @targetLength.
+ *              LZ4HC_strat_opt : hash chain, optimal parser (level 10).
+ *              LZ4HC_strat_btopt : optimal parser (levels 11-12), starting with hash chain, which switches to a binary tree
+ *                                  when long chains make it slower, as in text or binaries.
+ *                                  Blocks up to ~128 KB keep hash chain. Same as LZ4HC_strat_opt if LZ4HC_HEAPMODE==0.
+ *  @nbSearches : max nb of match candidates compared per position, >= 1 (ex: 256 at level 9, 96 at level 10).
+ *  @targetLength : optimal parser only : a match this long is selected without further analysis,
+ *                  within [LZ4HC_TARGETLENGTH_MIN, LZ4HC_TARGETLENGTH_MAX]. Values beyond are clamped.
+ *                  LZ4HC_TARGETLENGTH_MAX also makes the parser evaluate all positions (level 12).
+ */
+typedef enum {
+    LZ4HC_strat_mid = 0,
+    LZ4HC_strat_hc,
+    LZ4HC_strat_opt,
+    LZ4HC_strat_btopt
+} LZ4HC_strategy_e;
+
+typedef struct {
+    LZ4HC_strategy_e strategy;
+    int nbSearches;
+    int targetLength;
+} LZ4HC_cParams_t;
+
+#define LZ4HC_TARGETLENGTH_MIN  4
+#define LZ4HC_TARGETLENGTH_MAX  (1 << 12)
+
+/*! LZ4_getCompressionParametersHC() :
+ * @return : parameters employed by @compressionLevel (clamped like LZ4_setCompressionLevel()),
+ *           as a starting point for LZ4_compress_HC_extStateHC_advanced() and LZ4_compress_HC_continue_advanced().
+ */
+LZ4LIB_STATIC_API LZ4HC_cParams_t LZ4_getCompressionParametersHC(int compressionLevel);
+
+/*! LZ4_compress_HC_extStateHC_advanced() :
+ *  Same as LZ4_compress_HC_extStateHC(), but compresses using @cParams instead of a compression level.
+ *  Output is identical to LZ4_compress_HC_extStateHC() when @cParams == LZ4_getCompressionParametersHC(level).
+ *  @stateHC must have been initialized once, using LZ4_initStreamHC() or LZ4_initStreamHC_advanced().
+ *  It's then fully reset, but keeps its table sizes.
+ * @return : compressed size, or 0 if compression fails or @cParams is invalid.
+ */
+LZ4LIB_STATIC_API int LZ4_compress_HC_extStateHC_advanced(void* stateHC,
+                                const char* src, char* dst,
+                                int srcSize, int dstCapacity,
+                                const LZ4HC_cParams_t* cParams);
+
+/*! LZ4_compress_HC_continue_advanced() :
+ *  Same as LZ4_compress_HC_continue(), but compresses this block using @cParams.
+ *  Parameters can change between blocks. They only apply to the current invocation :
+ *  the stream's compression level is not modified, and still decides how history is indexed
+ *  (level 2 : LZ4HC_strat_mid, levels 3+ : other strategies).
+ *  Compression is valid in any case, but for best results, combine @cParams with a stream level of the same family.
+ * @return : compressed size, or 0 if compression fails or @cParams is invalid.
+ */
+LZ4LIB_STATIC_API int LZ4_compress_HC_continue_advanced(LZ4_streamHC_t* streamHCPtr,
+                                const char* src, char* dst,
+                                int srcSize, int dstCapacity,
+                                const LZ4HC_cParams_t* cParams);
+
 #if defined (__cplusplus)
 }
 #endif
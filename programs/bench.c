@@ -125,6 +125,8 @@ int g_additionalParam = 0;
 int g_benchSeparately = 0;
 int g_decodeOnly = 0;
 unsigned g_skipChecksums = 0;
+static BMK_tuneTarget_e g_tuneTarget = BMK_tune_off;
+static double g_tuneMinValue = 0.;
 
 void BMK_setNotificationLevel(unsigned level) { g_displayLevel=level; }
 
@@ -144,6 +146,8 @@ void BMK_setDecodeOnlyMode(int set) { g_decodeOnly = (set!=0); }
 
 void BMK_skipChecksums(int skip) { g_skipChecksums = (skip!=0); }
 
+void BMK_setAutotune(BMK_tuneTarget_e target, double minValue) { g_tuneTarget = target; g_tuneMinValue = minValue; }
+
 
 /* *************************************
  *  Compression state management
@@ -152,6 +156,7 @@ void BMK_skipChecksums(int skip) { g_skipChecksums = (skip!=0); }
 struct compressionParameters
 {
     int cLevel;
+    const LZ4HC_cParams_t* hcParams;   /* when != NULL, replaces cLevel for HC compression */
     const char* dictBuf;
     int dictSize;
 
@@ -201,6 +206,15 @@ LZ4_compressInitStreamHC(struct compressionParameters* pThis)
     LZ4_loadDictHC(pThis->LZ4_dictStreamHC, pThis->dictBuf, pThis->dictSize);
 }
 
+static void
+LZ4_compressInitStateHC(struct compressionParameters* pThis)
+{
+    pThis->LZ4_stream = NULL;
+    pThis->LZ4_dictStream = NULL;
+    pThis->LZ4_streamHC = LZ4_createStreamHC();
+    pThis->LZ4_dictStreamHC = NULL;
+}
+
 static void
 LZ4_compressResetNoStream(const struct compressionParameters* cparams)
 {
@@ -238,6 +252,14 @@ LZ4_compressBlockNoStreamHC(const struct compressionParameters* cparams,
     return LZ4_compress_HC(src, dst, srcSize, dstSize, cparams->cLevel);
 }
 
+static int
+LZ4_compressBlockStateHCParams(const struct compressionParameters* cparams,
+                               const char* src, char* dst,
+                               int srcSize, int dstSize)
+{
+    return LZ4_compress_HC_extStateHC_advanced(cparams->LZ4_streamHC, src, dst, srcSize, dstSize, cparams->hcParams);
+}
+
 static int
 LZ4_compressBlockStream(const struct compressionParameters* cparams,
                         const char* src, char* dst,
@@ -257,6 +279,15 @@ LZ4_compressBlockStreamHC(const struct compressionParameters* cparams,
     return LZ4_compress_HC_continue(cparams->LZ4_streamHC, src, dst, srcSize, dstSize);
 }
 
+static int
+LZ4_compressBlockStreamHCParams(const struct compressionParameters* cparams,
+                                const char* src, char* dst,
+                                int srcSize, int dstSize)
+{
+    LZ4_compressResetStreamHC(cparams);
+    return LZ4_compress_HC_continue_advanced(cparams->LZ4_streamHC, src, dst, srcSize, dstSize, cparams->hcParams);
+}
+
 static void
 LZ4_compressCleanupNoStream(const struct compressionParameters* cparams)
 {
@@ -277,16 +308,37 @@ LZ4_compressCleanupStreamHC(const struct compressionParameters* cparams)
     LZ4_freeStreamHC(cparams->LZ4_dictStreamHC);
 }
 
+static void
+LZ4_compressCleanupStateHC(const struct compressionParameters* cparams)
+{
+    LZ4_freeStreamHC(cparams->LZ4_streamHC);
+}
+
 static void
 LZ4_buildCompressionParameters(struct compressionParameters* pParams,
-                               int cLevel,
+                               int cLevel, const LZ4HC_cParams_t* hcParams,
                          const char* dictBuf, int dictSize)
 {
     pParams->cLevel = cLevel;
+    pParams->hcParams = hcParams;
     pParams->dictBuf = dictBuf;
     pParams->dictSize = dictSize;
 
-    if (dictSize) {
+    if (hcParams) {
+        /* stream level must belong to the same family as @hcParams (see LZ4_compress_HC_continue_advanced()) */
+        pParams->cLevel = (hcParams->strategy == LZ4HC_strat_mid) ? LZ4HC_CLEVEL_MIN : LZ4HC_CLEVEL_DEFAULT;
+        if (dictSize) {
+            pParams->initFunction = LZ4_compressInitStreamHC;
+            pParams->resetFunction = LZ4_compressResetStreamHC;
+            pParams->blockFunction = LZ4_compressBlockStreamHCParams;
+            pParams->cleanupFunction = LZ4_compressCleanupStreamHC;
+        } else {
+            pParams->initFunction = LZ4_compressInitStateHC;
+            pParams->resetFunction = LZ4_compressResetNoStream;
+            pParams->blockFunction = LZ4_compressBlockStateHCParams;
+            pParams->cleanupFunction = LZ4_compressCleanupStateHC;
+        }
+    } else if (dictSize) {
         if (cLevel < LZ4HC_CLEVEL_MIN) {
             pParams->initFunction = LZ4_compressInitStream;
             pParams->resetFunction = LZ4_compressResetStream;
@@ -354,13 +406,25 @@ typedef struct {
     size_t resSize;
 } blockParam_t;
 
+typedef struct {
+    size_t cSize;
+    double cSpeed;   /* MB/s */
+    double dSpeed;   /* MB/s */
+} BMK_result_t;
+
 #define MIN(a,b) ((a)<(b) ? (a) : (b))
 #define MAX(a,b) ((a)>(b) ? (a) : (b))
 
+/* BMK_benchMem() :
+ * @hcParams is optional, it's possible to provide NULL.
+ * When provided, HC compression uses these parameters instead of @cLevel.
+ * @result is optional, when provided, it receives measurements of this run. */
 static int BMK_benchMem(const void* srcBuffer, size_t srcSize,
                         const char* displayName, int cLevel,
+                        const LZ4HC_cParams_t* hcParams,
                         const size_t* fileSizes, U32 nbFiles,
-                        const char* dictBuf, int dictSize)
+                        const char* dictBuf, int dictSize,
+                        BMK_result_t* result)
 {
     size_t const blockSize = (g_blockSize>=32 && !g_decodeOnly ? g_blockSize : srcSize) + (!srcSize) /* avoid div by 0 */ ;
     U32 const maxNbBlocks = (U32)((srcSize + (blockSize-1)) / blockSize) + nbFiles;
@@ -382,7 +446,7 @@ static int BMK_benchMem(const void* srcBuffer, size_t srcSize,
     if (strlen(displayName)>17) displayName += strlen(displayName)-17;   /* can only display 17 characters */
 
     /* init */
-    LZ4_buildCompressionParameters(&compP, cLevel, dictBuf, dictSize);
+    LZ4_buildCompressionParameters(&compP, cLevel, hcParams, dictBuf, dictSize);
     compP.initFunction(&compP);
     if (g_dctx==NULL) {
         LZ4F_createDecompressionContext(&g_dctx, LZ4F_VERSION);
@@ -608,6 +672,12 @@ static int BMK_benchMem(const void* srcBuffer, size_t srcSize,
                 DISPLAYOUT("(param=%d)", g_additionalParam);
             DISPLAYOUT("\n");
         }
+
+        if (result) {
+            result->cSize = cSize;
+            result->cSpeed = ((double)srcSize / (double)fastestC) * 1000;
+            result->dSpeed = ((double)srcSize / (double)fastestD) * 1000;
+        }
     }   /* Bench */
 
     /* clean up */
@@ -643,6 +713,206 @@ static size_t BMK_findMaxMem(U64 requiredMem)
 }
 
 
+/* *************************************
+*  Autotune
+***************************************/
+typedef struct {
+    int cLevel;                 /* < 1 : fast mode, like --fast=-cLevel */
+    int useParams;              /* HC compression using @hcParams instead of @cLevel */
+    LZ4HC_cParams_t hcParams;
+} BMK_tuneConfig_t;
+
+static const BMK_tuneConfig_t k_tuneConfigs[] = {
+    { -31, 0, { LZ4HC_strat_mid, 0, 0 } },
+    { -15, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {  -7, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {  -3, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {  -1, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {   1, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {   2, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {   3, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {   4, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {   5, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {   6, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {   7, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {   8, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {   9, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {   9, 1, { LZ4HC_strat_hc,  512, 16 } },   /* between levels 9 and 10 */
+    {   9, 1, { LZ4HC_strat_hc, 1024, 16 } },
+    {  10, 1, { LZ4HC_strat_opt,  16, 32 } },
+    {  10, 1, { LZ4HC_strat_opt,  32, 48 } },
+    {  10, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {  11, 0, { LZ4HC_strat_mid, 0, 0 } },
+    {  12, 0, { LZ4HC_strat_mid, 0, 0 } },
+};
+#define BMK_NB_TUNE_CONFIGS (sizeof(k_tuneConfigs) / sizeof(k_tuneConfigs[0]))
+
+static const size_t k_tuneBlockSizes[] = { 64 KB, 256 KB, 1 MB, 4 MB };
+#define BMK_NB_TUNE_BLOCKSIZES (sizeof(k_tuneBlockSizes) / sizeof(k_tuneBlockSizes[0]))
+
+typedef struct {
+    const BMK_tuneConfig_t* config;
+    size_t blockSize;
+    double ratio;
+    BMK_result_t result;
+} BMK_tunePoint_t;
+
+static void BMK_tuneLabel(char* label, size_t labelSize, const BMK_tuneConfig_t* config)
+{
+    if (config->useParams) {
+        static const char* const stratNames[] = { "mid", "hc", "opt", "btopt" };
+        if (config->hcParams.strategy == LZ4HC_strat_hc) {
+            snprintf(label, labelSize, "hc,%i", config->hcParams.nbSearches);
+        } else {
+            snprintf(label, labelSize, "%s,%i,%i", stratNames[config->hcParams.strategy],
+                    config->hcParams.nbSearches, config->hcParams.targetLength);
+        }
+    } else if (config->cLevel < 1) {
+        snprintf(label, labelSize, "--fast=%i", -config->cLevel);
+    } else {
+        snprintf(label, labelSize, "-%i", config->cLevel);
+    }
+}
+
+/* p1 dominates p2 if it's at least as good on all criteria, and better on one */
+static int BMK_dominates(const BMK_tunePoint_t* p1, const BMK_tunePoint_t* p2)
+{
+    if (p1->result.cSpeed < p2->result.cSpeed) return 0;
+    if (p1->result.dSpeed < p2->result.dSpeed) return 0;
+    if (p1->ratio < p2->ratio) return 0;
+    return (p1->result.cSpeed > p2->result.cSpeed)
+        || (p1->result.dSpeed > p2->result.dSpeed)
+        || (p1->ratio > p2->ratio);
+}
+
+static void BMK_displayTunePoint(const char* prefix, const BMK_tunePoint_t* point)
+{
+    char label[32];
+    BMK_tuneLabel(label, sizeof(label), point->config);
+    DISPLAYOUT("%s%-12s %5u KB %7.3f %8.1f MB/s %8.1f MB/s \n", prefix, label,
+            (unsigned)(point->blockSize >> 10), point->ratio,
+            point->result.cSpeed, point->result.dSpeed);
+}
+
+/* BMK_autotune() :
+ * benchmarks all combinations of k_tuneConfigs and block sizes,
+ * then displays the Pareto-optimal ones, and the best one for g_tuneTarget */
+static int BMK_autotune(void* srcBuffer, size_t benchedSize,
+                        const char* displayName,
+                        const size_t* fileSizes, unsigned nbFiles,
+                        const char* dictBuf, int dictSize)
+{
+    size_t const savedBlockSize = g_blockSize;
+    size_t const* const blockSizes = (g_blockSize >= 32) ? &savedBlockSize : k_tuneBlockSizes;
+    size_t const nbBlockSizes = (g_blockSize >= 32) ? 1 : BMK_NB_TUNE_BLOCKSIZES;
+    BMK_tunePoint_t* const points = (BMK_tunePoint_t*)malloc(BMK_NB_TUNE_CONFIGS * nbBlockSizes * sizeof(*points));
+    size_t nbPoints = 0;
+    size_t b, c, n;
+    int benchError = 0;
+
+    if (points == NULL) END_PROCESS(32, "allocation error : not enough memory");
+    DISPLAYLEVEL(2, "Autotune %s : %u settings x %u block sizes \n", displayName,
+                (unsigned)BMK_NB_TUNE_CONFIGS, (unsigned)nbBlockSizes);
+
+    for (b = 0; b < nbBlockSizes; b++) {
+        /* larger blocks than input give same results */
+        if ((b > 0) && (blockSizes[b-1] >= benchedSize)) break;
+        g_blockSize = blockSizes[b];
+        for (c = 0; c < BMK_NB_TUNE_CONFIGS; c++) {
+            const BMK_tuneConfig_t* const config = k_tuneConfigs + c;
+            BMK_tunePoint_t* const point = points + nbPoints++;
+            char runName[32];
+            char label[20];
+            BMK_tuneLabel(label, sizeof(label), config);
+            snprintf(runName, sizeof(runName), "%s B%uK", label, (unsigned)(g_blockSize >> 10));
+            benchError |= BMK_benchMem(srcBuffer, benchedSize,
+                                runName, config->cLevel,
+                                config->useParams ? &config->hcParams : NULL,
+                                fileSizes, nbFiles,
+                                dictBuf, dictSize,
+                                &point->result);
+            point->config = config;
+            point->blockSize = g_blockSize;
+            point->ratio = (double)benchedSize / (double)point->result.cSize;
+    }   }
+    g_blockSize = savedBlockSize;
+
+    /* Pareto frontier, by decreasing compression speed */
+    {   size_t* const frontier = (size_t*)malloc(nbPoints * sizeof(*frontier));
+        size_t nbOptimal = 0;
+        if (frontier == NULL) END_PROCESS(32, "allocation error : not enough memory");
+        for (n = 0; n < nbPoints; n++) {
+            size_t u;
+            for (u = 0; u < nbPoints; u++)
+                if (BMK_dominates(points + u, points + n)) break;
+            if (u < nbPoints) continue;
+            for (u = nbOptimal; (u > 0) && (points[frontier[u-1]].result.cSpeed < points[n].result.cSpeed); u--)
+                frontier[u] = frontier[u-1];
+            frontier[u] = n;
+            nbOptimal++;
+        }
+        OUTLEVEL(1, "\nPareto frontier (%u of %u points) : \n", (unsigned)nbOptimal, (unsigned)nbPoints);
+        OUTLEVEL(1, "  %-12s %8s %7s %13s %13s \n", "setting", "block", "ratio", "compression", "decompression");
+        for (n = 0; n < nbOptimal; n++) {
+            if (g_displayLevel >= 1) BMK_displayTunePoint("  ", points + frontier[n]);
+        }
+        free(frontier);
+    }
+
+    /* recommendation : optimal point respecting the target constraint */
+    if (g_tuneTarget != BMK_tune_pareto) {
+        static const char* const metricNames[] = { "", "", "compression speed", "decompression speed", "ratio" };
+        char constraint[64];
+        const BMK_tunePoint_t* best = NULL;
+        const BMK_tunePoint_t* closest = NULL;   /* when no point respects the constraint */
+        for (n = 0; n < nbPoints; n++) {
+            const BMK_tunePoint_t* const p = points + n;
+            double const value = (g_tuneTarget == BMK_tune_minCSpeed) ? p->result.cSpeed :
+                                 (g_tuneTarget == BMK_tune_minDSpeed) ? p->result.dSpeed : p->ratio;
+            double const closestValue = (closest == NULL) ? 0. :
+                                 (g_tuneTarget == BMK_tune_minCSpeed) ? closest->result.cSpeed :
+                                 (g_tuneTarget == BMK_tune_minDSpeed) ? closest->result.dSpeed : closest->ratio;
+            if ((closest == NULL) || (value > closestValue)) closest = p;
+            if (value < g_tuneMinValue) continue;
+            if (best == NULL) { best = p; continue; }
+            if (g_tuneTarget == BMK_tune_minRatio) {
+                /* maximize compression speed */
+                if ( (p->result.cSpeed > best->result.cSpeed)
+                  || ((p->result.cSpeed == best->result.cSpeed) && (p->ratio > best->ratio)) )
+                    best = p;
+            } else {
+                /* maximize ratio */
+                if ( (p->ratio > best->ratio)
+                  || ((p->ratio == best->ratio) && (p->result.cSpeed > best->result.cSpeed)) )
+                    best = p;
+        }   }
+        assert(g_tuneTarget >= BMK_tune_minCSpeed && g_tuneTarget <= BMK_tune_minRatio);
+        if (g_tuneTarget == BMK_tune_minRatio)
+            snprintf(constraint, sizeof(constraint), "%s >= %.3f", metricNames[g_tuneTarget], g_tuneMinValue);
+        else
+            snprintf(constraint, sizeof(constraint), "%s >= %.1f MB/s", metricNames[g_tuneTarget], g_tuneMinValue);
+        if (best == NULL) {
+            OUTLEVEL(1, "\nNo setting reaches %s; closest : \n", constraint);
+            best = closest;
+        } else {
+            OUTLEVEL(1, "\nRecommended for %s, maximizing %s : \n", constraint,
+                    (g_tuneTarget == BMK_tune_minRatio) ? "compression speed" : "ratio");
+        }
+        if (g_displayLevel >= 1) {
+            BMK_displayTunePoint("  ", best);
+            if (best->config->useParams) {
+                OUTLEVEL(1, "  (HC parameters : LZ4_compress_HC_*_advanced(), no command line equivalent) \n");
+            } else {
+                char label[32];
+                BMK_tuneLabel(label, sizeof(label), best->config);
+                OUTLEVEL(1, "  lz4 %s -B%u \n", label, (unsigned)best->blockSize);
+    }   }   }
+
+    free(points);
+    return benchError;
+}
+
+
 static int BMK_benchCLevel(void* srcBuffer, size_t benchedSize,
                             const char* displayName, int cLevel, int cLevelLast,
                             const size_t* fileSizes, unsigned nbFiles,
@@ -659,14 +929,17 @@ static int BMK_benchCLevel(void* srcBuffer, size_t benchedSize,
     if (g_displayLevel == 1 && !g_additionalParam)
         DISPLAY("bench %s %s: input %u bytes, %u seconds, %u KB blocks\n", LZ4_VERSION_STRING, LZ4_GIT_COMMIT_STRING, (U32)benchedSize, g_nbSeconds, (U32)(g_blockSize>>10));
 
+    if (g_tuneTarget != BMK_tune_off)
+        return BMK_autotune(srcBuffer, benchedSize, displayName, fileSizes, nbFiles, dictBuf, dictSize);
+
     if (cLevelLast < cLevel) cLevelLast = cLevel;
 
     for (l=cLevel; l <= cLevelLast; l++) {
         benchError |= BMK_benchMem(
                             srcBuffer, benchedSize,
-                            displayName, l,
+                            displayName, l, NULL,
                             fileSizes, nbFiles,
-                            dictBuf, dictSize);
+                            dictBuf, dictSize, NULL);
     }
     return benchError;
 }
@@ -816,6 +1089,8 @@ int BMK_benchFiles(const char** fileNamesTable, unsigned nbFiles,
             DISPLAYLEVEL(2, "+ Checksum when present \n");
         }
         cLevelLast = cLevel;
+        if (g_tuneTarget != BMK_tune_off)
+            END_PROCESS(27, "Error : autotune not compatible with decode-only mode");
     }
     if (cLevelLast > LZ4HC_CLEVEL_MAX) cLevelLast = LZ4HC_CLEVEL_MAX;
     if (cLevelLast < cLevel) cLevelLast = cLevel;
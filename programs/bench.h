@@ -51,4 +51,21 @@ void BMK_skipChecksums(int skip);           /* v1.9.4+: only useful for DecodeOn
 
 void BMK_setAdditionalParam(int additionalParam); /* hidden param, influence output format, for python parsing */
 
+/* BMK_setAutotune() :
+ * Instead of benchmarking levels from @cLevelStart to @cLevelLast,
+ * BMK_benchFiles() sweeps fast modes, compression levels, some HC parameters between levels 9 and 10,
+ * and block sizes (64 KB - 4 MB, or only the one set by BMK_setBlockSize()).
+ * It then displays the Pareto-optimal settings for (compression speed, decompression speed, ratio),
+ * and recommends the one maximizing ratio under a minimum speed constraint (BMK_tune_minCSpeed, BMK_tune_minDSpeed),
+ * or maximizing compression speed under a minimum ratio constraint (BMK_tune_minRatio).
+ * @minValue is expressed in MB/s for speeds. */
+typedef enum {
+    BMK_tune_off = 0,
+    BMK_tune_pareto,      /* Pareto frontier only, no recommendation */
+    BMK_tune_minCSpeed,
+    BMK_tune_minDSpeed,
+    BMK_tune_minRatio
+} BMK_tuneTarget_e;
+void BMK_setAutotune(BMK_tuneTarget_e target, double minValue);
+
 #endif   /* BENCH_H_125623623633 */
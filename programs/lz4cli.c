@@ -176,6 +176,8 @@ static int usage_advanced(const char* exeName)
     DISPLAY( " -b#    : benchmark file(s), using # compression level (default : 1) \n");
     DISPLAY( " -e#    : test all compression levels from -bX to # (default : 1)\n");
     DISPLAY( " -i#    : minimum evaluation time in seconds (default : 3s) \n");
+    DISPLAY( "--autotune[=c#|d#|r#] : benchmark many settings, display the Pareto-optimal ones, \n");
+    DISPLAY( "          and the best one for >= # MB/s compression (c), decompression (d), or ratio >= # (r) \n");
     if (g_lz4c_legacy_commands) {
         DISPLAY( "Legacy arguments : \n");
         DISPLAY( " -c0    : fast compression \n");
@@ -516,6 +518,29 @@ int main(int argCount, const char** argv)
 
                 /* For gzip(1) compatibility */
                 if (!strcmp(argument,  "--best")) { cLevel=LZ4HC_CLEVEL_MAX; continue; }
+
+                if (longCommandWArg(&argument, "--autotune")) {
+                    /* optional target : c# / d# (min compression / decompression speed, MB/s), r# (min ratio) */
+                    BMK_tuneTarget_e target = BMK_tune_pareto;
+                    double minValue = 0.;
+                    if (*argument == '=') {
+                        char* end;
+                        switch (argument[1]) {
+                        case 'c': target = BMK_tune_minCSpeed; break;
+                        case 'd': target = BMK_tune_minDSpeed; break;
+                        case 'r': target = BMK_tune_minRatio; break;
+                        default : badusage(exeName);
+                        }
+                        minValue = strtod(argument+2, &end);
+                        if ((end == argument+2) || (*end != 0) || (minValue < 0)) badusage(exeName);
+                    } else if (*argument != 0) {
+                        /* Invalid character following --autotune */
+                        badusage(exeName);
+                    }
+                    BMK_setAutotune(target, minValue);
+                    mode = om_bench; multiple_inputs=1;
+                    continue;
+                }
             }
 
             while (argument[1]!=0) {
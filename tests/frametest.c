@@ -276,6 +276,13 @@ static int bug1227(void)
 #define CHECK_V(v,f) v = f; if (LZ4F_isError(v)) { fprintf(stderr, "%s \n", LZ4F_getErrorName(v)); goto _output_error; }
 #define CHECK(f)   { LZ4F_errorCode_t const CHECK_V(err_ , f); }
 
+/* runs jobs sequentially, in reverse order, to emulate an out-of-order thread pool */
+static void FUZ_parallelFor_reverse(void* opaque, LZ4F_segmentJob_f job, void* jobCtx, unsigned nbSegments)
+{
+    (void)opaque;
+    while (nbSegments) job(jobCtx, --nbSegments);
+}
+
 static int unitTests(U32 seed, double compressibility)
 {
 #define COMPRESSIBLE_NOISE_LENGTH (2 MB)
@@ -580,6 +587,192 @@ static int unitTests(U32 seed, double compressibility)
         CHECK( LZ4F_freeDecompressionContext(dctx) );
     }
 
+    DISPLAYLEVEL(3, "LZ4F_compressFrame with skipIncompressible : ");
+    {   size_t const mixedSize = 1 MB;
+        BYTE* const mixed = (BYTE*)malloc(mixedSize);
+        int const levels[2] = { 1, 9 };   /* fast, HC */
+        int l, linked;
+        LZ4F_decompressionContext_t dctx;
+        if (mixed == NULL) goto _output_error;
+        CHECK( LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION) );
+        /* first half compressible, second half random */
+        memcpy(mixed, CNBuffer, mixedSize / 2);
+        {   size_t n;
+            for (n = mixedSize / 2; n < mixedSize; n++) mixed[n] = (BYTE)FUZ_rand(randState);
+        }
+        for (l = 0; l < 2; l++) {
+            for (linked = 0; linked < 2; linked++) {
+                size_t decodedSize = COMPRESSIBLE_NOISE_LENGTH;
+                size_t iSize;
+                memset(&prefs, 0, sizeof(prefs));
+                prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+                prefs.frameInfo.blockMode = linked ? LZ4F_blockLinked : LZ4F_blockIndependent;
+                prefs.compressionLevel = levels[l];
+                prefs.skipIncompressible = 1;
+                CHECK_V(cSize, LZ4F_compressFrame(compressedBuffer, cBuffSize, mixed, mixedSize, &prefs) );
+                if (cSize >= mixedSize) goto _output_error;   /* compressible half must still be compressed */
+                iSize = cSize;
+                CHECK( LZ4F_decompress(dctx, decodedBuffer, &decodedSize, compressedBuffer, &iSize, NULL) );
+                if (decodedSize != mixedSize) goto _output_error;
+                if (memcmp(decodedBuffer, mixed, mixedSize)) goto _output_error;
+        }   }
+        CHECK( LZ4F_freeDecompressionContext(dctx) );
+        free(mixed);
+        memset(&prefs, 0, sizeof(prefs));
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4F_compressFrame_segmented : ");
+    {   size_t const segmentSize = 256 KB;
+        size_t const segBound = LZ4F_compressFrameBound_segmented(testSize, segmentSize, NULL);
+        BYTE* const seqBuffer = (BYTE*)malloc(segBound);
+        BYTE* const revBuffer = (BYTE*)malloc(segBound);
+        int const levels[2] = { 1, 9 };   /* fast, HC */
+        int l, linked;
+        LZ4F_decompressionContext_t dctx;
+        if (seqBuffer == NULL || revBuffer == NULL) goto _output_error;
+        CHECK( LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION) );
+        for (l = 0; l < 2; l++) {
+            for (linked = 0; linked < 2; linked++) {
+                size_t seqSize, revSize, refSize;
+                size_t decodedSize = COMPRESSIBLE_NOISE_LENGTH;
+                size_t iSize;
+                memset(&prefs, 0, sizeof(prefs));
+                prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+                prefs.frameInfo.blockMode = linked ? LZ4F_blockLinked : LZ4F_blockIndependent;
+                prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+                prefs.frameInfo.contentSize = 1;   /* auto-corrected */
+                prefs.compressionLevel = levels[l];
+                CHECK_V(refSize, LZ4F_compressFrame(revBuffer, segBound, CNBuffer, testSize, &prefs) );
+                CHECK_V(seqSize, LZ4F_compressFrame_segmented(seqBuffer, segBound, CNBuffer, testSize, segmentSize, &prefs, NULL, NULL) );
+                DISPLAYLEVEL(4, "level %i, linked=%i : %u vs %u bytes ; ", levels[l], linked, (unsigned)seqSize, (unsigned)refSize);
+                if (seqSize > refSize + refSize / 64) goto _output_error;   /* ratio must be preserved */
+                CHECK_V(revSize, LZ4F_compressFrame_segmented(revBuffer, segBound, CNBuffer, testSize, segmentSize, &prefs, FUZ_parallelFor_reverse, NULL) );
+                if (revSize != seqSize || memcmp(revBuffer, seqBuffer, seqSize)) goto _output_error;   /* order must not matter */
+                iSize = seqSize;
+                CHECK( LZ4F_decompress(dctx, decodedBuffer, &decodedSize, seqBuffer, &iSize, NULL) );
+                if (decodedSize != testSize || iSize != seqSize) goto _output_error;
+                if (memcmp(decodedBuffer, CNBuffer, testSize)) goto _output_error;
+        }   }
+        {   size_t const r = LZ4F_compressFrame_segmented(seqBuffer, segBound - 1, CNBuffer, testSize, segmentSize, NULL, NULL, NULL);
+            if (!LZ4F_isError(r)) goto _output_error;   /* dstCapacity too small */
+        }
+        {   size_t decodedSize = COMPRESSIBLE_NOISE_LENGTH;
+            size_t iSize;
+            CHECK_V(cSize, LZ4F_compressFrame_segmented(seqBuffer, segBound, CNBuffer, 0, 0, NULL, NULL, NULL) );
+            iSize = cSize;
+            CHECK( LZ4F_decompress(dctx, decodedBuffer, &decodedSize, seqBuffer, &iSize, NULL) );
+            if (decodedSize != 0 || iSize != cSize) goto _output_error;
+        }
+        CHECK( LZ4F_freeDecompressionContext(dctx) );
+        free(revBuffer);
+        free(seqBuffer);
+        memset(&prefs, 0, sizeof(prefs));
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4F_decompress_inPlace : ");
+    {   size_t const maxBufferSize = MAX(LZ4F_DECOMPRESS_INPLACE_BUFFER_SIZE(testSize, 64 KB), LZ4F_DECOMPRESS_INPLACE_BUFFER_SIZE(testSize, 256 KB));
+        BYTE* const buffer = (BYTE*)malloc(maxBufferSize);
+        BYTE* const noise = (BYTE*)malloc(testSize);
+        LZ4F_decompressionContext_t dctx;
+        unsigned config;
+        if (buffer == NULL || noise == NULL) goto _output_error;
+        {   size_t n; U32 rand32 = 1;
+            for (n = 0; n < testSize; n++) noise[n] = (BYTE)(FUZ_rand(&rand32) >> 5);
+            memcpy(noise, CNBuffer, testSize / 2);   /* half compressible, half incompressible (stored blocks) */
+        }
+        CHECK( LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION) );
+        for (config = 0; config < 32; config++) {
+            const void* const src = (config & 16) ? noise : CNBuffer;
+            size_t const blockSize = (config & 1) ? 256 KB : 64 KB;
+            size_t const bufferSize = LZ4F_DECOMPRESS_INPLACE_BUFFER_SIZE(testSize, blockSize);
+            size_t dSize;
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockSizeID = (config & 1) ? LZ4F_max256KB : LZ4F_max64KB;
+            prefs.frameInfo.blockMode = (config & 2) ? LZ4F_blockLinked : LZ4F_blockIndependent;
+            prefs.frameInfo.blockChecksumFlag = (config & 4) ? LZ4F_blockChecksumEnabled : LZ4F_noBlockChecksum;
+            prefs.frameInfo.contentChecksumFlag = (config & 8) ? LZ4F_contentChecksumEnabled : LZ4F_noContentChecksum;
+            prefs.frameInfo.contentSize = (config & 8) ? testSize : 0;
+            prefs.compressionLevel = (config & 4) ? 9 : 1;
+            assert(bufferSize <= maxBufferSize);
+            /* compress, then move frame to the end of buffer */
+            CHECK_V(cSize, LZ4F_compressFrame(buffer, bufferSize, src, testSize, &prefs) );
+            memmove(buffer + bufferSize - cSize, buffer, cSize);
+            CHECK_V(dSize, LZ4F_decompress_inPlace(dctx, buffer, bufferSize, cSize) );
+            if (dSize != testSize) goto _output_error;
+            if (memcmp(buffer, src, testSize)) goto _output_error;
+
+            /* buffer too short : must be detected */
+            CHECK_V(cSize, LZ4F_compressFrame(buffer, bufferSize, src, testSize, &prefs) );
+            memmove(buffer + testSize - cSize, buffer, cSize);
+            {   size_t const r = LZ4F_decompress_inPlace(dctx, buffer, testSize, cSize);
+                if ((config & 16) == 0) {
+                    if (LZ4F_getErrorCode(r) != LZ4F_ERROR_dstMaxSize_tooSmall) goto _output_error;
+                } else {
+                    if (!LZ4F_isError(r) && (r != testSize || memcmp(buffer, src, testSize))) goto _output_error;
+            }   }
+        }
+        CHECK( LZ4F_freeDecompressionContext(dctx) );
+        free(noise);
+        free(buffer);
+        memset(&prefs, 0, sizeof(prefs));
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4F_decompress into alternating buffers : ");
+    {   size_t const srcSize = 1 MB;
+        size_t const frameCapacity = srcSize + (srcSize / 1000 + 2) * 16 + LZ4F_HEADER_SIZE_MAX;
+        size_t const outSize = 128 KB;   /* each call fills at least 64 KB, so previous buffer holds history */
+        BYTE* const frame = (BYTE*)malloc(frameCapacity);
+        BYTE* const out[2] = { (BYTE*)malloc(outSize), (BYTE*)malloc(outSize) };
+        LZ4F_decompressionContext_t dctx;
+        unsigned config;
+        if (frame == NULL || out[0] == NULL || out[1] == NULL) goto _output_error;
+        CHECK( LZ4F_createCompressionContext(&cctx, LZ4F_VERSION) );
+        CHECK( LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION) );
+        for (config = 0; config < 8; config++) {
+            size_t const flushInterval = (config & 1) ? 20000 : 1000;   /* small blocks, as when flushing messages */
+            LZ4F_decompressOptions_t dOpt;
+            size_t fSize, pos, ipos = 0, opos = 0;
+            int k = 0;
+            memset(&prefs, 0, sizeof(prefs));
+            prefs.frameInfo.blockMode = LZ4F_blockLinked;
+            prefs.frameInfo.contentChecksumFlag = (config & 2) ? LZ4F_contentChecksumEnabled : LZ4F_noContentChecksum;
+            memset(&dOpt, 0, sizeof(dOpt));
+            dOpt.stableDst = (config >> 2) & 1;
+            CHECK_V(fSize, LZ4F_compressBegin(cctx, frame, frameCapacity, &prefs) );
+            for (pos = 0; pos < srcSize; pos += flushInterval) {
+                size_t const chunk = MIN(flushInterval, srcSize - pos);
+                CHECK_V(cSize, LZ4F_compressUpdate(cctx, frame + fSize, frameCapacity - fSize, (const BYTE*)CNBuffer + pos, chunk, NULL) );
+                fSize += cSize;
+                CHECK_V(cSize, LZ4F_flush(cctx, frame + fSize, frameCapacity - fSize, NULL) );
+                fSize += cSize;
+            }
+            CHECK_V(cSize, LZ4F_compressEnd(cctx, frame + fSize, frameCapacity - fSize, NULL) );
+            fSize += cSize;
+            while (ipos < fSize) {
+                size_t dSize = outSize, iSize = fSize - ipos;
+                size_t const r = LZ4F_decompress(dctx, out[k], &dSize, frame + ipos, &iSize, &dOpt);
+                CHECK(r);
+                if (opos + dSize > srcSize) goto _output_error;
+                if (memcmp(out[k], (const BYTE*)CNBuffer + opos, dSize)) goto _output_error;
+                opos += dSize;
+                ipos += iSize;
+                k ^= 1;
+                if (r == 0) break;
+            }
+            if ((ipos != fSize) || (opos != srcSize)) goto _output_error;
+        }
+        CHECK( LZ4F_freeDecompressionContext(dctx) );
+        CHECK( LZ4F_freeCompressionContext(cctx) );
+        cctx = NULL;
+        free(out[0]); free(out[1]);
+        free(frame);
+        memset(&prefs, 0, sizeof(prefs));
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
     /* frame content size tests */
     {   size_t cErr;
         BYTE* const ostart = (BYTE*)compressedBuffer;
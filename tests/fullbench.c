@@ -43,6 +43,7 @@
 #include <time.h>        /* clock_t, clock(), CLOCKS_PER_SEC */
 
 #define LZ4_DISABLE_DEPRECATE_WARNINGS   /* LZ4_decompress_fast */
+#define LZ4_STATIC_LINKING_ONLY   /* LZ4_compress_batch */
 #include "lz4.h"
 #include "lz4hc.h"
 #include "lz4frame.h"
@@ -237,6 +238,49 @@ static int local_LZ4_compress_fast_continue0(const char* in, char* out, int inSi
     return LZ4_compress_fast_continue(&LZ4_stream, in, out, inSize, LZ4_compressBound(inSize), 0);
 }
 
+#ifndef LZ4_DLL_IMPORT
+/* many small independent items, compressed into a scratch buffer */
+#define BATCH_ITEM_SIZE (1 KB)
+#define BATCH_NB_ITEMS 64
+static char g_batchDst[BATCH_NB_ITEMS * LZ4_COMPRESSBOUND(BATCH_ITEM_SIZE)];
+
+static int local_LZ4_compress_fastReset_items(const char* in, char* out, int inSize)
+{
+    int total = 0;
+    int pos;
+    (void)out;
+    for (pos = 0; pos < inSize; pos += BATCH_ITEM_SIZE) {
+        int const srcSize = (inSize - pos < BATCH_ITEM_SIZE) ? inSize - pos : BATCH_ITEM_SIZE;
+        char* const dst = g_batchDst + ((pos / BATCH_ITEM_SIZE) % BATCH_NB_ITEMS) * LZ4_COMPRESSBOUND(BATCH_ITEM_SIZE);
+        total += LZ4_compress_fast_extState_fastReset(&LZ4_stream, in + pos, dst, srcSize, LZ4_COMPRESSBOUND(BATCH_ITEM_SIZE), 0);
+    }
+    return total;
+}
+
+static int local_LZ4_compress_batch(const char* in, char* out, int inSize)
+{
+    LZ4_batchItem_t items[BATCH_NB_ITEMS];
+    int total = 0;
+    int pos = 0;
+    (void)out;
+    while (pos < inSize) {
+        int nbItems = 0;
+        int n;
+        while ((nbItems < BATCH_NB_ITEMS) && (pos < inSize)) {
+            items[nbItems].src = in + pos;
+            items[nbItems].dst = g_batchDst + nbItems * LZ4_COMPRESSBOUND(BATCH_ITEM_SIZE);
+            items[nbItems].srcSize = (inSize - pos < BATCH_ITEM_SIZE) ? inSize - pos : BATCH_ITEM_SIZE;
+            items[nbItems].dstCapacity = LZ4_COMPRESSBOUND(BATCH_ITEM_SIZE);
+            pos += items[nbItems].srcSize;
+            nbItems++;
+        }
+        LZ4_compress_batch(&LZ4_stream, items, nbItems, 0);
+        for (n = 0; n < nbItems; n++) total += items[n].cSize;
+    }
+    return total;
+}
+#endif
+
 #ifndef LZ4_DLL_IMPORT
 #if defined (__cplusplus)
 extern "C" {
@@ -526,6 +570,10 @@ static const CompressionDesc compDescArray[] = {
     { "LZ4F_compressUpdate", local_LZ4F_compress, NULL, 1 },
     { "LZ4_saveDict", local_LZ4_saveDict, local_LZ4_saveDict_init, 0 },
     { "LZ4_saveDictHC", local_LZ4_saveDictHC, local_LZ4_saveDictHC_init, 0 },
+#ifndef LZ4_DLL_IMPORT
+    { "LZ4_compress_fastReset(1KB items)", local_LZ4_compress_fastReset_items, local_LZ4_createStream, 0 },
+    { "LZ4_compress_batch(1KB items)", local_LZ4_compress_batch, local_LZ4_createStream, 0 },
+#endif
 
 };
 
@@ -1075,6 +1075,51 @@ static int FUZ_test(U32 seed, U32 nbCycles, const U32 startCycle, const double c
 #define testCompressedSize (130 KB)
 #define ringBufferSize (8 KB)
 
+typedef struct {
+    int nbAllocs;
+    int nbFrees;
+    size_t lastAlignment;
+    int lastNumaNode;
+    size_t lastSize;
+    size_t lastFreedSize;
+} FUZ_allocStats;
+
+static void* FUZ_countingAlloc(void* opaque, size_t size, size_t alignment, int numaNode)
+{
+    FUZ_allocStats* const stats = (FUZ_allocStats*)opaque;
+    stats->nbAllocs++;
+    stats->lastAlignment = alignment;
+    stats->lastNumaNode = numaNode;
+    stats->lastSize = size;
+    return malloc(size);
+}
+
+static void FUZ_countingFree(void* opaque, void* address, size_t size)
+{
+    FUZ_allocStats* const stats = (FUZ_allocStats*)opaque;
+    stats->nbFrees++;
+    stats->lastFreedSize = size;
+    free(address);
+}
+
+typedef struct {
+    const char* dst;        /* start of decoded output */
+    size_t interval;
+    size_t total;
+    int nbChunks;
+    int nbShortChunks;
+    int nbMisplaced;
+} FUZ_checkpointStats;
+
+static void FUZ_checkpoint(void* opaque, const char* data, size_t size)
+{
+    FUZ_checkpointStats* const stats = (FUZ_checkpointStats*)opaque;
+    stats->nbMisplaced += (data != stats->dst + stats->total);
+    stats->nbShortChunks += (size < stats->interval);
+    stats->total += size;
+    stats->nbChunks++;
+}
+
 static void FUZ_unitTests(int compressionLevel)
 {
     const unsigned testNb = 0;
@@ -1187,6 +1232,52 @@ static void FUZ_unitTests(int compressionLevel)
     }   }   }   }   }
     DISPLAYLEVEL(3, " OK \n");
 
+    /* long matches, ending on a mismatch or on input end at every position (vectorized LZ4_count) */
+    DISPLAYLEVEL(3, "long matches ending at every position :");
+    {   int const blockSize = 300;
+        int mismatchPos, tailSize;
+        FUZ_fillCompressibleNoiseBuffer(testInput, blockSize, 0.0, &randState);
+        for (mismatchPos = 0; mismatchPos < 100; mismatchPos++) {
+            for (tailSize = 0; tailSize < 40; tailSize++) {
+                int const srcSize = blockSize + mismatchPos + 1 + tailSize;
+                int cSize, dSize;
+                memcpy(testInput + blockSize, testInput, (size_t)(mismatchPos + 1 + tailSize));
+                testInput[blockSize + mismatchPos] = (char)(testInput[mismatchPos] ^ 0x5A);
+                cSize = LZ4_compress_default(testInput, testCompressed, srcSize, (int)testCompressedSize);
+                FUZ_CHECKTEST(cSize == 0, "LZ4_compress_default() failed (mismatchPos=%i, tailSize=%i)", mismatchPos, tailSize);
+                dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize);
+                FUZ_CHECKTEST(dSize != srcSize || memcmp(testInput, testVerify, (size_t)srcSize),
+                            "round trip failed (mismatchPos=%i, tailSize=%i)", mismatchPos, tailSize);
+    }   }   }
+    DISPLAYLEVEL(3, " OK \n");
+
+    /* literal runs of 32*k bytes (LZ4_wildCopyLong()), compressed into every capacity */
+    DISPLAYLEVEL(3, "literal runs of 32*k bytes at exact capacity :");
+    {   int k;
+        for (k = 1; k <= 10; k++) {
+            int const litLength = 32 * k;
+            int const srcSize = 2 * litLength;
+            int const fullSize = LZ4_compressBound(srcSize);
+            int dstCapacity;
+            FUZ_fillCompressibleNoiseBuffer(testInput, (size_t)litLength, 0.0, &randState);
+            memcpy(testInput + litLength, testInput, (size_t)litLength);
+            for (dstCapacity = fullSize; dstCapacity > 0; dstCapacity--) {
+                int cSize;
+                memset(testCompressed, 0xA5, (size_t)fullSize + 16);
+                cSize = LZ4_compress_default(testInput, testCompressed, srcSize, dstCapacity);
+                {   int n;
+                    for (n = dstCapacity; n < fullSize + 16; n++)
+                        FUZ_CHECKTEST((unsigned char)testCompressed[n] != 0xA5,
+                                    "LZ4_compress_default() overwrites beyond dstCapacity (litLength=%i, dstCapacity=%i, pos=%i)",
+                                    litLength, dstCapacity, n);
+                }
+                if (cSize == 0) continue;
+                FUZ_CHECKTEST(LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize) != srcSize
+                            || memcmp(testInput, testVerify, (size_t)srcSize),
+                            "round trip failed (litLength=%i, dstCapacity=%i)", litLength, dstCapacity);
+    }   }   }
+    DISPLAYLEVEL(3, " OK \n");
+
     DISPLAYLEVEL(3, "LZ4_initStream with multiple valid alignments : ");
     {   typedef struct {
             LZ4_stream_t state1;
@@ -1297,6 +1388,436 @@ static void FUZ_unitTests(int compressionLevel)
         }   }
     }
 
+    DISPLAYLEVEL(3, "LZ4_initStream_advanced() with runtime hash table sizes : ");
+    FUZ_CHECKTEST(LZ4_sizeofState_advanced(0) != LZ4_sizeofState(), "LZ4_sizeofState_advanced(0) should be LZ4_sizeofState()");
+    FUZ_CHECKTEST(LZ4_sizeofState_advanced(LZ4_STREAM_HASHLOG_MIN-1) != 0, "hashLog too small should be rejected");
+    FUZ_CHECKTEST(LZ4_sizeofState_advanced(LZ4_STREAM_HASHLOG_MAX+1) != 0, "hashLog too large should be rejected");
+    {   int const hashLogs[] = { LZ4_STREAM_HASHLOG_MIN, LZ4_STREAM_HASHLOG_MIN+2, 0, LZ4_STREAM_HASHLOG_MAX };
+        size_t n;
+        LZ4_stream_t* const dictStream = LZ4_createStream();
+        int const dictSize = 32 KB;
+        const char* const dict = testInput;
+        const char* const src = testInput + dictSize;
+        int const srcSize = 100 KB;
+        U64 const crcOrig = XXH64(src, (size_t)srcSize, 0);
+        FUZ_CHECKTEST(dictStream==NULL, "LZ4_createStream() allocation failed");
+        LZ4_loadDict(dictStream, dict, dictSize);
+        for (n=0; n<sizeof(hashLogs)/sizeof(hashLogs[0]); n++) {
+            int const hashLog = hashLogs[n];
+            int const stateSize = LZ4_sizeofState_advanced(hashLog);
+            void* const stateBuffer = malloc((size_t)stateSize);
+            LZ4_stream_t* ctx;
+            int cSize, dSize;
+            FUZ_CHECKTEST(stateBuffer==NULL, "not enough memory");
+            FUZ_CHECKTEST(LZ4_initStream_advanced(stateBuffer, (size_t)stateSize-1, hashLog) != NULL, "init must fail : buffer too small");
+            ctx = LZ4_initStream_advanced(stateBuffer, (size_t)stateSize, hashLog);
+            FUZ_CHECKTEST(ctx==NULL, "LZ4_initStream_advanced(hashLog=%i) failed", hashLog);
+
+            /* one-shot, small and large inputs */
+            cSize = LZ4_compress_fast_extState_fastReset(ctx, src, testCompressed, 3 KB, LZ4_compressBound(3 KB), 1);
+            FUZ_CHECKTEST(cSize==0, "LZ4_compress_fast_extState_fastReset() failed (hashLog=%i)", hashLog);
+            dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize);
+            FUZ_CHECKTEST(dSize!=3 KB || memcmp(src, testVerify, 3 KB), "small block round trip failed (hashLog=%i)", hashLog);
+            cSize = LZ4_compress_fast_extState_fastReset(ctx, src, testCompressed, srcSize, (int)testCompressedSize, 1);
+            FUZ_CHECKTEST(cSize==0, "LZ4_compress_fast_extState_fastReset() failed (hashLog=%i)", hashLog);
+            dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize);
+            FUZ_CHECKTEST(dSize!=srcSize, "LZ4_decompress_safe() failed (hashLog=%i)", hashLog);
+            FUZ_CHECKTEST(XXH64(testVerify, (size_t)dSize, 0) != crcOrig, "decompression corruption (hashLog=%i)", hashLog);
+
+            /* loaded dictionary */
+            LZ4_loadDict(ctx, dict, dictSize);
+            cSize = LZ4_compress_fast_continue(ctx, src, testCompressed, srcSize, (int)testCompressedSize, 1);
+            FUZ_CHECKTEST(cSize==0, "LZ4_compress_fast_continue() after LZ4_loadDict() failed (hashLog=%i)", hashLog);
+            dSize = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, srcSize, dict, dictSize);
+            FUZ_CHECKTEST(dSize!=srcSize, "LZ4_decompress_safe_usingDict() failed (hashLog=%i)", hashLog);
+            FUZ_CHECKTEST(XXH64(testVerify, (size_t)dSize, 0) != crcOrig, "decompression corruption (hashLog=%i)", hashLog);
+
+            /* index renormalization, which rescales the whole table */
+            LZ4_loadDict(ctx, dict, dictSize);
+            ctx->internal_donotuse.currentOffset = 0x80000000U - (U32)srcSize / 2;   /* next block triggers LZ4_renormDictT() */
+            cSize = LZ4_compress_fast_continue(ctx, src, testCompressed, srcSize, (int)testCompressedSize, 1);
+            FUZ_CHECKTEST(cSize==0, "LZ4_compress_fast_continue() with renormalization failed (hashLog=%i)", hashLog);
+            FUZ_CHECKTEST(ctx->internal_donotuse.currentOffset >= 0x80000000U, "indexes were not renormalized (hashLog=%i)", hashLog);
+            dSize = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, srcSize, dict, dictSize);
+            FUZ_CHECKTEST(dSize!=srcSize, "LZ4_decompress_safe_usingDict() after renormalization failed (hashLog=%i)", hashLog);
+            FUZ_CHECKTEST(XXH64(testVerify, (size_t)dSize, 0) != crcOrig, "decompression corruption after renormalization (hashLog=%i)", hashLog);
+
+            /* attached dictionary, possibly of different table size */
+            LZ4_resetStream_fast(ctx);
+            LZ4_attach_dictionary(ctx, dictStream);
+            cSize = LZ4_compress_fast_continue(ctx, src, testCompressed, 2 KB, (int)testCompressedSize, 1);
+            FUZ_CHECKTEST(cSize==0, "LZ4_compress_fast_continue() with attached dictionary failed (hashLog=%i)", hashLog);
+            dSize = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, srcSize, dict, dictSize);
+            FUZ_CHECKTEST(dSize!=2 KB || memcmp(src, testVerify, 2 KB), "attached dictionary round trip failed (hashLog=%i)", hashLog);
+            free(stateBuffer);
+        }
+        LZ4_freeStream(dictStream);
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4_compress_batch() : ");
+    {   LZ4_stream_t* const state = LZ4_createStream();
+        LZ4_batchItem_t items[24];
+        int const nbItems = (int)(sizeof(items) / sizeof(items[0]));
+        size_t srcPos = 0, dstPos = 0;
+        int n, nbCompressed;
+        FUZ_CHECKTEST(state==NULL, "LZ4_createStream() allocation failed");
+        FUZ_fillCompressibleNoiseBuffer(testInput, testInputSize, 0.5, &randState);
+        for (n = 0; n < nbItems; n++) {
+            /* mostly small items, some beyond 4 KB, one >= 64 KB, one empty */
+            int const srcSize = (n == 7) ? (int)(66 KB) : (n == 13) ? 0 : (n % 4 == 3) ? (int)(4 KB + FUZ_rand(&randState) % (4 KB)) : (int)(FUZ_rand(&randState) % (1 KB)) + 1;
+            int const dstCapacity = (n == 21) ? srcSize / 4 : LZ4_compressBound(srcSize);   /* item 21 : not enough room */
+            assert(srcPos + (size_t)srcSize <= testInputSize);
+            assert(dstPos + (size_t)dstCapacity <= testCompressedSize);
+            items[n].src = testInput + srcPos;
+            items[n].dst = testCompressed + dstPos;
+            items[n].srcSize = srcSize;
+            items[n].dstCapacity = dstCapacity;
+            items[n].cSize = -1;
+            srcPos += (size_t)srcSize;
+            dstPos += (size_t)dstCapacity;
+        }
+        nbCompressed = LZ4_compress_batch(state, items, nbItems, 1);
+        FUZ_CHECKTEST(nbCompressed != nbItems - 1, "LZ4_compress_batch() should fail only 1 item (%i/%i)", nbCompressed, nbItems);
+        FUZ_CHECKTEST(items[21].cSize != 0, "item with too small dstCapacity should fail");
+        for (n = 0; n < nbItems; n++) {
+            int dSize;
+            if (n == 21) continue;
+            FUZ_CHECKTEST(items[n].cSize <= 0, "LZ4_compress_batch() failed on item %i", n);
+            dSize = LZ4_decompress_safe(items[n].dst, testVerify, items[n].cSize, items[n].srcSize);
+            FUZ_CHECKTEST(dSize != items[n].srcSize, "item %i : wrong decompressed size (%i != %i)", n, dSize, items[n].srcSize);
+            FUZ_CHECKTEST(memcmp(items[n].src, testVerify, (size_t)dSize), "item %i : decompression corruption", n);
+        }
+        LZ4_freeStream(state);
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4_compress_destSize_multi() : ");
+    {   LZ4_stream_t* const state = LZ4_createStream();
+        const char* srcs[16];
+        int srcSizes[16];
+        int blockOffsets[16+1];
+        int const nbSources = (int)(sizeof(srcs) / sizeof(srcs[0]));
+        int const targetDstSize = 16 KB;
+        int n, nbPacked;
+        FUZ_CHECKTEST(state==NULL, "LZ4_createStream() allocation failed");
+        FUZ_fillCompressibleNoiseBuffer(testInput, testInputSize, 0.5, &randState);
+        for (n = 0; n < nbSources; n++) {
+            srcs[n] = testInput + (size_t)n * (4 KB);
+            srcSizes[n] = 4 KB;
+        }
+        testCompressed[targetDstSize] = 'x';
+        nbPacked = LZ4_compress_destSize_multi(state, srcs, srcSizes, nbSources, testCompressed, targetDstSize, blockOffsets, 1);
+        FUZ_CHECKTEST(nbPacked < 4 || nbPacked >= nbSources, "unexpected nb of packed sources (%i)", nbPacked);
+        FUZ_CHECKTEST(blockOffsets[nbPacked] > targetDstSize, "packed blocks exceed target size");
+        FUZ_CHECKTEST(testCompressed[targetDstSize] != 'x', "write beyond target size");
+        FUZ_CHECKTEST(targetDstSize - blockOffsets[nbPacked] >= LZ4_compressBound(srcSizes[nbPacked]), "next source would have fit");
+        for (n = 0; n < nbPacked; n++) {
+            int const cSize = blockOffsets[n+1] - blockOffsets[n];
+            int const dSize = LZ4_decompress_safe(testCompressed + blockOffsets[n], testVerify, cSize, srcSizes[n]);
+            FUZ_CHECKTEST(dSize != srcSizes[n], "block %i : wrong decompressed size (%i != %i)", n, dSize, srcSizes[n]);
+            FUZ_CHECKTEST(memcmp(srcs[n], testVerify, (size_t)dSize), "block %i : decompression corruption", n);
+        }
+        /* state remains usable after a source failed to fit */
+        {   int const cSize = LZ4_compress_fast_extState_fastReset(state, testInput, testCompressed, 4 KB, LZ4_compressBound(4 KB), 1);
+            int const dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, 4 KB);
+            FUZ_CHECKTEST(dSize != 4 KB || memcmp(testInput, testVerify, 4 KB), "state unusable after LZ4_compress_destSize_multi()");
+        }
+        FUZ_CHECKTEST(LZ4_compress_destSize_multi(state, srcs, srcSizes, nbSources, testCompressed, 10, blockOffsets, 1) != 0, "no source should fit into 10 bytes");
+        FUZ_CHECKTEST(blockOffsets[0] != 0, "blockOffsets[0] must be 0");
+        LZ4_freeStream(state);
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "decompression of repeated patterns, offsets 1-31 : ");
+    {   int offset;
+        for (offset = 1; offset < 32; offset++) {
+            /* runs of a short pattern, separated by a few random bytes, so that most matches use @offset */
+            int const srcSize = 64 KB + offset;
+            int pos = 0;
+            int cSize, dSize;
+            while (pos < srcSize) {
+                int const runLength = 20 + (int)(FUZ_rand(&randState) % 300);
+                int n;
+                for (n = 0; (n < runLength) && (pos < srcSize); n++, pos++)
+                    testInput[pos] = (n < offset) ? (char)FUZ_rand(&randState) : testInput[pos - offset];
+            }
+            cSize = LZ4_compress_default(testInput, testCompressed, srcSize, (int)testCompressedSize);
+            FUZ_CHECKTEST(cSize <= 0, "compression failed (offset %i)", offset);
+            dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize);
+            FUZ_CHECKTEST(dSize != srcSize, "decompression failed (offset %i)", offset);
+            FUZ_CHECKTEST(memcmp(testInput, testVerify, (size_t)srcSize), "corruption (offset %i)", offset);
+    }   }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4_decompress_safe_step() : ");
+    {   LZ4_stream_t cStream;
+        LZ4_streamDecode_t dStream;
+        LZ4_blockDecoder_t bd;
+        int const blockSize = 48 KB;
+        int cSizes[2];
+        int b;
+        FUZ_fillCompressibleNoiseBuffer(testInput, testInputSize, 0.5, &randState);
+        LZ4_initStream(&cStream, sizeof(cStream));
+        LZ4_setStreamDecode(&dStream, NULL, 0);
+        /* 2 dependent blocks : the second one uses the first one as history */
+        cSizes[0] = LZ4_compress_fast_continue(&cStream, testInput, testCompressed, blockSize, LZ4_compressBound(blockSize), 1);
+        cSizes[1] = LZ4_compress_fast_continue(&cStream, testInput + blockSize, testCompressed + cSizes[0], blockSize, LZ4_compressBound(blockSize), 1);
+        FUZ_CHECKTEST((cSizes[0] <= 0) || (cSizes[1] <= 0), "compression failed");
+        for (b = 0; b < 2; b++) {
+            const char* const src = testCompressed + (b ? cSizes[0] : 0);
+            char* const dst = testVerify + b * blockSize;
+            int r, nbSteps = 0;
+            FUZ_CHECKTEST(LZ4_initBlockDecoder(&bd, src, cSizes[b], dst, blockSize, &dStream), "LZ4_initBlockDecoder() failed");
+            do {
+                int const stepSize = (int)(FUZ_rand(&randState) % 3000) + 1;
+                int const before = LZ4_blockDecoder_decodedSize(&bd);
+                r = LZ4_decompress_safe_step(&bd, stepSize);
+                FUZ_CHECKTEST(r < 0, "LZ4_decompress_safe_step() failed");
+                FUZ_CHECKTEST(LZ4_blockDecoder_decodedSize(&bd) - before > stepSize, "step produced more than requested");
+                FUZ_CHECKTEST(memcmp(testInput + b * blockSize, dst, (size_t)LZ4_blockDecoder_decodedSize(&bd)), "block %i : corruption after %i steps", b, nbSteps);
+                nbSteps++;
+            } while (r > 0);
+            FUZ_CHECKTEST(LZ4_blockDecoder_decodedSize(&bd) != blockSize, "block %i : wrong decoded size", b);
+            FUZ_CHECKTEST(nbSteps < blockSize / 3000, "block %i : too few steps (%i)", b, nbSteps);
+        }
+        /* truncated input */
+        FUZ_CHECKTEST(LZ4_initBlockDecoder(&bd, testCompressed, cSizes[0] - 1, testVerify, blockSize, NULL), "LZ4_initBlockDecoder() failed");
+        while (LZ4_decompress_safe_step(&bd, 1 KB) > 0) {}
+        FUZ_CHECKTEST(LZ4_decompress_safe_step(&bd, 1 KB) >= 0, "truncated input should be detected");
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4_decompress_safe_usingDict_withCheckpoints() : ");
+    {   int const dictSize = 32 KB;
+        int const srcSize = 128 KB;
+        char* const dict = testVerify;
+        char* const dst = testVerify + dictSize;
+        FUZ_checkpointStats stats;
+        LZ4_stream_t cStream;
+        int cSize, r, withPrefix;
+        FUZ_fillCompressibleNoiseBuffer(testInput, testInputSize, 0.5, &randState);
+        LZ4_initStream(&cStream, sizeof(cStream));
+        LZ4_loadDict(&cStream, testInput, dictSize);
+        cSize = LZ4_compress_fast_continue(&cStream, testInput + dictSize, testCompressed, srcSize, LZ4_compressBound(srcSize), 1);
+        FUZ_CHECKTEST(cSize <= 0, "compression failed");
+        for (withPrefix = 0; withPrefix < 2; withPrefix++) {
+            /* dictionary either right before dst (prefix), or in another buffer (external dictionary) */
+            const char* const dictStart = withPrefix ? dict : testInput;
+            memcpy(dict, testInput, (size_t)dictSize);
+            memset(&stats, 0, sizeof(stats));
+            stats.dst = dst;
+            stats.interval = 5000;
+            r = LZ4_decompress_safe_usingDict_withCheckpoints(testCompressed, dst, cSize, srcSize, dictStart, dictSize,
+                                                              FUZ_checkpoint, &stats, stats.interval);
+            FUZ_CHECKTEST(r != srcSize, "decompression failed (%i)", r);
+            FUZ_CHECKTEST(memcmp(testInput + dictSize, dst, (size_t)srcSize), "decompression corruption");
+            FUZ_CHECKTEST(stats.total != (size_t)srcSize, "checkpoints don't cover the whole output");
+            FUZ_CHECKTEST(stats.nbMisplaced, "checkpoints are not contiguous");
+            FUZ_CHECKTEST(stats.nbShortChunks > 1, "only the last chunk can be shorter than interval");
+            FUZ_CHECKTEST(stats.nbChunks < srcSize / (int)(2 * stats.interval), "too few checkpoints (%i)", stats.nbChunks);
+        }
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4_decompress_safe_range() : ");
+    {   int const srcSize = 160 KB;
+        int const intervals[] = { 1, 3000, 64 KB, 1 MB };
+        int round;
+        FUZ_fillCompressibleNoiseBuffer(testInput, testInputSize, 0.3, &randState);
+        for (round = 0; round < 8; round++) {
+            int const interval = intervals[round % 4];
+            int const cSize = (round < 4) ? LZ4_compress_default(testInput, testCompressed, srcSize, (int)testCompressedSize)
+                                          : LZ4_compress_HC(testInput, testCompressed, srcSize, (int)testCompressedSize, 9);
+            int const indexSize = LZ4_buildRangeIndex(testCompressed, cSize, testInput, srcSize, interval, NULL, 0);
+            void* const index = malloc((size_t)(indexSize > 0 ? indexSize : 1));
+            int wkspSize, n;
+            void* wksp;
+            FUZ_CHECKTEST(cSize <= 0, "compression failed");
+            FUZ_CHECKTEST(indexSize <= 0, "index measurement failed (%i)", indexSize);
+            FUZ_CHECKTEST(index == NULL, "allocation failed");
+            FUZ_CHECKTEST(LZ4_buildRangeIndex(testCompressed, cSize, testInput, srcSize, interval, index, indexSize-1) >= 0, "index capacity too small should be detected");
+            FUZ_CHECKTEST(LZ4_buildRangeIndex(testCompressed, cSize, testInput, srcSize-1, interval, index, indexSize) >= 0, "wrong decoded size should be detected");
+            FUZ_CHECKTEST(LZ4_buildRangeIndex(testCompressed, cSize, testInput, srcSize, interval, index, indexSize) != indexSize, "index build failed");
+            wkspSize = LZ4_decompress_range_workspaceSize(index, indexSize, 20 KB);
+            FUZ_CHECKTEST(wkspSize < (int)(20 KB), "workspace size query failed (%i)", wkspSize);
+            wksp = malloc((size_t)wkspSize);
+            FUZ_CHECKTEST(wksp == NULL, "allocation failed");
+            for (n = 0; n < 200; n++) {
+                int const rangeSize = (n == 0) ? 0 : (int)(FUZ_rand(&randState) % (20 KB + 1));
+                int const rangeStart = (n == 1) ? 0 : (n == 2) ? srcSize - rangeSize : (int)(FUZ_rand(&randState) % (U32)(srcSize - rangeSize + 1));
+                int const r = LZ4_decompress_safe_range(testCompressed, cSize, index, indexSize,
+                                                        testVerify, rangeStart, rangeSize, wksp, wkspSize);
+                FUZ_CHECKTEST(r != rangeSize, "range [%i, +%i) decoding failed (%i)", rangeStart, rangeSize, r);
+                FUZ_CHECKTEST(memcmp(testVerify, testInput + rangeStart, (size_t)rangeSize), "range [%i, +%i) decoding corruption", rangeStart, rangeSize);
+            }
+            FUZ_CHECKTEST(LZ4_decompress_safe_range(testCompressed, cSize, index, indexSize, testVerify, srcSize - 99, 100, wksp, wkspSize) >= 0, "range beyond block should be rejected");
+            FUZ_CHECKTEST(LZ4_decompress_safe_range(testCompressed, cSize-1, index, indexSize, testVerify, 0, 100, wksp, wkspSize) >= 0, "mismatching block should be rejected");
+            FUZ_CHECKTEST(LZ4_decompress_safe_range(testCompressed, cSize, index, indexSize-1, testVerify, 0, 100, wksp, wkspSize) >= 0, "truncated index should be rejected");
+            FUZ_CHECKTEST(LZ4_decompress_safe_range(testCompressed, cSize, index, indexSize, testVerify, srcSize / 2, 20 KB, wksp, 20 KB) >= 0, "workspace too small should be detected");
+            free(wksp);
+            free(index);
+        }
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4_looksIncompressible() and LZ4_compress_fast_extState_probe() : ");
+    {   LZ4_stream_t state;
+        int const srcSize = 64 KB;
+        int cSize, dSize;
+        FUZ_fillCompressibleNoiseBuffer(testInput, (size_t)srcSize, 0.0, &randState);
+        FUZ_CHECKTEST(LZ4_looksIncompressible(testInput, srcSize) != 1, "noise should look incompressible");
+        FUZ_CHECKTEST(LZ4_looksIncompressible(testInput, 4 KB) != 0, "small inputs should not be probed");
+        cSize = LZ4_compress_fast_extState_probe(&state, testInput, testCompressed, srcSize, LZ4_compressBound(srcSize), 1);
+        FUZ_CHECKTEST(cSize <= srcSize || cSize > LZ4_compressBound(srcSize), "incompressible input should produce a literals-only block (%i)", cSize);
+        dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize);
+        FUZ_CHECKTEST(dSize != srcSize || memcmp(testInput, testVerify, (size_t)srcSize), "literals-only block round trip failed");
+        cSize = LZ4_compress_fast_extState_probe(&state, testInput, testCompressed, srcSize, srcSize, 1);
+        FUZ_CHECKTEST(cSize != 0, "incompressible input should fail when dstCapacity < LZ4_compressBound()");
+
+        memset(testInput, 'x', (size_t)srcSize);
+        FUZ_CHECKTEST(LZ4_looksIncompressible(testInput, srcSize) != 0, "repetitive content should not look incompressible");
+        FUZ_fillCompressibleNoiseBuffer(testInput, (size_t)srcSize, 0.9, &randState);
+        FUZ_CHECKTEST(LZ4_looksIncompressible(testInput, srcSize) != 0, "compressible noise should not look incompressible");
+        cSize = LZ4_compress_fast_extState_probe(&state, testInput, testCompressed, srcSize, (int)testCompressedSize, 1);
+        FUZ_CHECKTEST(cSize == 0 || cSize >= srcSize, "compressible input should be compressed (%i)", cSize);
+        dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize);
+        FUZ_CHECKTEST(dSize != srcSize || memcmp(testInput, testVerify, (size_t)srcSize), "round trip failed");
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4_CDict shared dictionary : ");
+    {   int const dictSize = 32 KB;
+        char* const dictCopy = (char*)malloc((size_t)dictSize);
+        LZ4_CDict* cdict;
+        LZ4_stream_t* const states[2] = { LZ4_createStream(), (LZ4_stream_t*)malloc((size_t)LZ4_sizeofState_advanced(LZ4_STREAM_HASHLOG_MIN)) };
+        int n;
+        FUZ_fillCompressibleNoiseBuffer(testInput, testInputSize, 0.5, &randState);
+        FUZ_CHECKTEST(dictCopy == NULL || states[0] == NULL || states[1] == NULL, "allocation failed");
+        FUZ_CHECKTEST(LZ4_initStream_advanced(states[1], (size_t)LZ4_sizeofState_advanced(LZ4_STREAM_HASHLOG_MIN), LZ4_STREAM_HASHLOG_MIN) == NULL, "init failed");
+        memcpy(dictCopy, testInput, (size_t)dictSize);
+        cdict = LZ4_createCDict(dictCopy, dictSize);
+        FUZ_CHECKTEST(cdict == NULL, "LZ4_createCDict() failed");
+        memset(dictCopy, 0, (size_t)dictSize);   /* cdict owns its own copy of content */
+        for (n = 0; n < 32; n++) {
+            LZ4_stream_t* const state = states[n & 1];
+            int const srcSize = (int)(FUZ_rand(&randState) % (2 KB)) + 1;
+            const char* const src = testInput + dictSize + (FUZ_rand(&randState) % (16 KB));
+            int const cSize = LZ4_compress_fast_usingCDict(state, cdict, src, testCompressed, srcSize, LZ4_compressBound(srcSize), 1);
+            int dSize;
+            FUZ_CHECKTEST(cSize <= 0, "LZ4_compress_fast_usingCDict() failed (message %i)", n);
+            dSize = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, srcSize, testInput, dictSize);
+            FUZ_CHECKTEST(dSize != srcSize || memcmp(src, testVerify, (size_t)srcSize), "message %i : round trip failed", n);
+        }
+        /* references into dictionary must be found */
+        {   const char* const src = testInput + dictSize;
+            int const cSizeNoDict = LZ4_compress_fast_usingCDict(states[0], NULL, src, testCompressed, 4 KB, (int)testCompressedSize, 1);
+            int const cSize = LZ4_compress_fast_usingCDict(states[0], cdict, src, testCompressed, 4 KB, (int)testCompressedSize, 1);
+            FUZ_CHECKTEST(cSize >= cSizeNoDict, "dictionary should improve compression (%i >= %i)", cSize, cSizeNoDict);
+        }
+        LZ4_freeCDict(cdict);
+        LZ4_freeCDict(NULL);   /* support free on NULL */
+        LZ4_freeStream(states[0]);
+        free(states[1]);
+        free(dictCopy);
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
+    DISPLAYLEVEL(3, "LZ4_CustomMem and state arena : ");
+    {   FUZ_allocStats stats;
+        LZ4_CustomMem cmem;
+        int const srcSize = 32 KB;
+        int cSize, dSize;
+        memset(&stats, 0, sizeof(stats));
+        cmem.customAlloc = FUZ_countingAlloc;
+        cmem.customFree = FUZ_countingFree;
+        cmem.opaqueState = &stats;
+        cmem.numaNode = 1;
+        {   LZ4_stream_t* const stream = LZ4_createStream_advanced(cmem, 0);
+            FUZ_CHECKTEST(stream == NULL, "LZ4_createStream_advanced() failed");
+            FUZ_CHECKTEST(stats.nbAllocs != 1 || stats.lastNumaNode != 1, "custom allocator not invoked as expected");
+            FUZ_CHECKTEST(stats.lastAlignment < sizeof(void*) || (stats.lastAlignment & (stats.lastAlignment-1)), "invalid alignment request (%u)", (unsigned)stats.lastAlignment);
+            cSize = LZ4_compress_fast_continue(stream, testInput, testCompressed, srcSize, (int)testCompressedSize, 1);
+            FUZ_CHECKTEST(cSize == 0, "compression failed");
+            dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize);
+            FUZ_CHECKTEST(dSize != srcSize || memcmp(testInput, testVerify, (size_t)srcSize), "round trip failed");
+            LZ4_freeStream_advanced(stream, cmem, 0);
+            FUZ_CHECKTEST(stats.nbFrees != 1, "custom free not invoked");
+        }
+        {   LZ4_streamHC_t* const streamHC = LZ4_createStreamHC_advanced(cmem, 0, 0);
+            FUZ_CHECKTEST(streamHC == NULL, "LZ4_createStreamHC_advanced() failed");
+            FUZ_CHECKTEST(stats.nbAllocs != 2, "custom allocator not invoked");
+            cSize = LZ4_compress_HC_continue(streamHC, testInput, testCompressed, srcSize, (int)testCompressedSize);
+            FUZ_CHECKTEST(cSize == 0, "HC compression failed");
+            dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize);
+            FUZ_CHECKTEST(dSize != srcSize || memcmp(testInput, testVerify, (size_t)srcSize), "HC round trip failed");
+            LZ4_freeStreamHC_advanced(streamHC, cmem, 0, 0);
+            FUZ_CHECKTEST(stats.nbFrees != 2, "custom free not invoked");
+        }
+        /* custom table sizes : allocation is sized accordingly */
+        {   LZ4_stream_t* const stream = LZ4_createStream_advanced(cmem, 10);
+            FUZ_CHECKTEST(stream == NULL, "LZ4_createStream_advanced(10) failed");
+            FUZ_CHECKTEST(stats.lastSize != (size_t)LZ4_sizeofState_advanced(10), "allocation size (%u) doesn't match hashLog 10", (unsigned)stats.lastSize);
+            cSize = LZ4_compress_fast_continue(stream, testInput, testCompressed, srcSize, (int)testCompressedSize, 1);
+            FUZ_CHECKTEST(cSize == 0, "compression with hashLog 10 failed");
+            dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize);
+            FUZ_CHECKTEST(dSize != srcSize || memcmp(testInput, testVerify, (size_t)srcSize), "round trip with hashLog 10 failed");
+            LZ4_freeStream_advanced(stream, cmem, 10);
+            FUZ_CHECKTEST(stats.lastFreedSize != stats.lastSize, "freed size differs from allocated size");
+        }
+        {   LZ4_streamHC_t* const streamHC = LZ4_createStreamHC_advanced(cmem, 12, 12);
+            FUZ_CHECKTEST(streamHC == NULL, "LZ4_createStreamHC_advanced(12, 12) failed");
+            FUZ_CHECKTEST(stats.lastSize != (size_t)LZ4_sizeofStateHC_advanced(12, 12), "allocation size (%u) doesn't match (12, 12)", (unsigned)stats.lastSize);
+            cSize = LZ4_compress_HC_continue(streamHC, testInput, testCompressed, srcSize, (int)testCompressedSize);
+            FUZ_CHECKTEST(cSize == 0, "HC compression with (12, 12) failed");
+            dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize);
+            FUZ_CHECKTEST(dSize != srcSize || memcmp(testInput, testVerify, (size_t)srcSize), "HC round trip with (12, 12) failed");
+            LZ4_freeStreamHC_advanced(streamHC, cmem, 12, 12);
+            FUZ_CHECKTEST(stats.lastFreedSize != stats.lastSize, "freed size differs from allocated size");
+        }
+        {   int const nbAllocs = stats.nbAllocs;
+            FUZ_CHECKTEST(LZ4_createStream_advanced(cmem, LZ4_STREAM_HASHLOG_MAX+1) != NULL, "invalid hashLog must be detected");
+            FUZ_CHECKTEST(LZ4_createStreamHC_advanced(cmem, 0, LZ4HC_CHAINLOG_MAX+1) != NULL, "invalid chainLog must be detected");
+            FUZ_CHECKTEST(stats.nbAllocs != nbAllocs, "no allocation expected for invalid parameters");
+        }
+        {   LZ4_CustomMem const defaultMem = { NULL, NULL, NULL, -1 };
+            LZ4_stream_t* const stream = LZ4_createStream_advanced(defaultMem, 0);
+            FUZ_CHECKTEST(stream == NULL, "LZ4_createStream_advanced() with default allocator failed");
+            LZ4_freeStream_advanced(stream, defaultMem, 0);
+        }
+        /* arena : several HC states within a single buffer */
+        {   size_t const arenaSize = 3 * sizeof(LZ4_streamHC_t) + 100;
+            char* const arenaBuffer = (char*)malloc(arenaSize);
+            LZ4_arena_t arena;
+            LZ4_streamHC_t* states[4];
+            int n, nbStates = 0;
+            FUZ_CHECKTEST(arenaBuffer == NULL, "allocation failed");
+            LZ4_initArena(&arena, arenaBuffer + 1, arenaSize - 1);   /* misaligned start */
+            cmem.customAlloc = LZ4_arenaAlloc;
+            cmem.customFree = NULL;
+            cmem.opaqueState = &arena;
+            for (n = 0; n < 4; n++) {
+                states[n] = LZ4_createStreamHC_advanced(cmem, 0, 0);
+                if (states[n] == NULL) break;
+                nbStates++;
+                FUZ_CHECKTEST((size_t)states[n] & 63, "state %i is not aligned", n);
+                FUZ_CHECKTEST((char*)states[n] < arenaBuffer || (char*)(states[n] + 1) > arenaBuffer + arenaSize, "state %i is out of arena", n);
+                FUZ_CHECKTEST(n && (states[n] < states[n-1] + 1), "state %i overlaps previous one", n);
+            }
+            FUZ_CHECKTEST(nbStates < 2 || nbStates > 3, "unexpected number of states within arena (%i)", nbStates);
+            for (n = 0; n < nbStates; n++) {
+                LZ4_setCompressionLevel(states[n], 2 + n);
+                cSize = LZ4_compress_HC_continue(states[n], testInput, testCompressed, srcSize, (int)testCompressedSize);
+                FUZ_CHECKTEST(cSize == 0, "HC compression from arena state %i failed", n);
+                dSize = LZ4_decompress_safe(testCompressed, testVerify, cSize, srcSize);
+                FUZ_CHECKTEST(dSize != srcSize || memcmp(testInput, testVerify, (size_t)srcSize), "arena state %i : round trip failed", n);
+                LZ4_freeStreamHC_advanced(states[n], cmem, 0, 0);   /* no-op */
+            }
+            free(arenaBuffer);
+        }
+    }
+    DISPLAYLEVEL(3, "OK \n");
+
     DISPLAYLEVEL(3, "LZ4_initStreamHC with multiple valid alignments : ");
     {   typedef struct {
             LZ4_streamHC_t hc1;
@@ -1396,6 +1917,201 @@ static void FUZ_unitTests(int compressionLevel)
         }
         DISPLAYLEVEL(3, " OK \n");
 
+        /* optimal levels, with history in a separate buffer, and long repetitions */
+        DISPLAYLEVEL(3, "HC levels 11-12 with extDict history : ");
+        {   /* text-like content has long hash chains : switches to binary tree match finder */
+            static const char* const words[] = { "lorem ", "ipsum ", "dolor ", "sit ", "amet, ", "consectetur ", "adipiscing ", "elit. " };
+            int const blockSize = 192 KB;
+            int const cCapacity = LZ4_compressBound(blockSize);
+            char* const blocks[2] = { (char*)malloc(blockSize), (char*)malloc(blockSize) };
+            char* const cBuffer = (char*)malloc((size_t)cCapacity);
+            char* const dBuffer = (char*)malloc((size_t)blockSize);
+            int cLevel, n;
+            assert(blocks[0] != NULL && blocks[1] != NULL && cBuffer != NULL && dBuffer != NULL);
+            for (n = 0; n < 2; n++) {
+                int pos = 0;
+                while (pos < blockSize) {
+                    const char* const word = words[FUZ_rand(&randState) % (sizeof(words) / sizeof(words[0]))];
+                    int const len = MIN((int)strlen(word), blockSize - pos);
+                    memcpy(blocks[n] + pos, word, (size_t)len);
+                    pos += len;
+                }
+                memset(blocks[n] + 10 KB, 'a', 5000);
+            }
+            for (cLevel = 11; cLevel <= LZ4HC_CLEVEL_MAX; cLevel++) {
+                LZ4_resetStreamHC_fast(&sHC, cLevel);
+                for (n = 0; n < 2; n++) {
+                    result = LZ4_compress_HC_continue(&sHC, blocks[n], cBuffer, blockSize, cCapacity);
+                    FUZ_CHECKTEST(result==0, "LZ4_compress_HC_continue() failed at level %i", cLevel);
+                    {   int const dSize = (n==0) ?
+                            LZ4_decompress_safe(cBuffer, dBuffer, result, blockSize) :
+                            LZ4_decompress_safe_usingDict(cBuffer, dBuffer, result, blockSize, blocks[0], blockSize);
+                        FUZ_CHECKTEST(dSize!=blockSize, "LZ4_decompress_safe_usingDict() failed at level %i", cLevel);
+                        FUZ_CHECKTEST(memcmp(dBuffer, blocks[n], (size_t)blockSize), "corruption at level %i", cLevel);
+            }   }   }
+            free(blocks[0]);
+            free(blocks[1]);
+            free(cBuffer);
+            free(dBuffer);
+        }
+        DISPLAYLEVEL(3, "OK \n");
+
+        /* hash and chain tables sized at runtime */
+        DISPLAYLEVEL(3, "LZ4_initStreamHC_advanced() with custom table sizes : ");
+        {   static const int tableLogs[][2] = { { 0, 0 }, { 10, 10 }, { 12, 12 }, { 17, 16 }, { 20, 13 } };
+            static const int cLevels[] = { 2, 6, 9, 10 };
+            int const dictSize = 32 KB;
+            int const blockSize = 40 KB;
+            int const nbBlocks = 4;
+            size_t t, l;
+            assert((size_t)(dictSize + nbBlocks * blockSize) <= testInputSize);
+            assert(LZ4_compressBound(blockSize) <= (int)testCompressedSize);
+            FUZ_CHECKTEST(LZ4_sizeofStateHC_advanced(0, 0) != LZ4_sizeofStateHC(), "default sizes must match LZ4_sizeofStateHC()");
+            FUZ_CHECKTEST(LZ4_sizeofStateHC_advanced(LZ4HC_HASHLOG_MAX+1, 0) != 0, "hashLog out of range must be detected");
+            FUZ_CHECKTEST(LZ4_sizeofStateHC_advanced(0, LZ4HC_CHAINLOG_MIN-1) != 0, "chainLog out of range must be detected");
+            FUZ_CHECKTEST(LZ4_sizeofStateHC_advanced(12, 12) > (int)(25 KB), "state (12, 12) should be ~24 KB");
+            for (t = 0; t < sizeof(tableLogs) / sizeof(tableLogs[0]); t++) {
+                int const hashLog = tableLogs[t][0];
+                int const chainLog = tableLogs[t][1];
+                int const stateSize = LZ4_sizeofStateHC_advanced(hashLog, chainLog);
+                void* const buffer = malloc((size_t)stateSize);
+                LZ4_streamHC_t* state;
+                assert(buffer != NULL);
+                FUZ_CHECKTEST(LZ4_initStreamHC_advanced(buffer, (size_t)stateSize - 1, hashLog, chainLog) != NULL,
+                            "(%i, %i) : buffer too small must be detected", hashLog, chainLog);
+                state = LZ4_initStreamHC_advanced(buffer, (size_t)stateSize, hashLog, chainLog);
+                FUZ_CHECKTEST(state == NULL, "LZ4_initStreamHC_advanced(%i, %i) failed", hashLog, chainLog);
+                for (l = 0; l < sizeof(cLevels) / sizeof(cLevels[0]); l++) {
+                    int n;
+                    LZ4_resetStreamHC_fast(state, cLevels[l]);
+                    LZ4_loadDictHC(state, testInput, dictSize);
+                    for (n = 0; n < nbBlocks; n++) {
+                        const char* const src = testInput + dictSize + n * blockSize;
+                        int const cSize = LZ4_compress_HC_continue(state, src, testCompressed, blockSize, LZ4_compressBound(blockSize));
+                        FUZ_CHECKTEST(cSize == 0, "(%i, %i) level %i : compression failed", hashLog, chainLog, cLevels[l]);
+                        {   int const dSize = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, blockSize, testInput, (int)(src - testInput));
+                            FUZ_CHECKTEST(dSize != blockSize, "(%i, %i) level %i : decompression failed", hashLog, chainLog, cLevels[l]);
+                            FUZ_CHECKTEST(memcmp(testVerify, src, (size_t)blockSize), "(%i, %i) level %i : corruption", hashLog, chainLog, cLevels[l]);
+                    }   }
+                    /* attach dictionary states of different table sizes, in both directions */
+                    for (n = 0; n < 2; n++) {
+                        LZ4_streamHC_t* const dictState = n ? &sHC : state;
+                        LZ4_streamHC_t* const workState = n ? state : &sHC;
+                        int cSize;
+                        LZ4_resetStreamHC_fast(&sHC, cLevels[l]);
+                        LZ4_resetStreamHC_fast(state, cLevels[l]);
+                        LZ4_loadDictHC(dictState, testInput, dictSize);
+                        LZ4_attach_HC_dictionary(workState, dictState);
+                        cSize = LZ4_compress_HC_continue(workState, testInput + dictSize, testCompressed, blockSize, LZ4_compressBound(blockSize));
+                        FUZ_CHECKTEST(cSize == 0, "(%i, %i) level %i : compression with attached dictionary failed", hashLog, chainLog, cLevels[l]);
+                        {   int const dSize = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, blockSize, testInput, dictSize);
+                            FUZ_CHECKTEST(dSize != blockSize, "(%i, %i) level %i : decompression with dictionary failed", hashLog, chainLog, cLevels[l]);
+                            FUZ_CHECKTEST(memcmp(testVerify, testInput + dictSize, (size_t)blockSize),
+                                        "(%i, %i) level %i : corruption with attached dictionary", hashLog, chainLog, cLevels[l]);
+                    }   }
+                    LZ4_attach_HC_dictionary(&sHC, NULL);
+                }
+                free(buffer);
+            }
+        }
+        DISPLAYLEVEL(3, "OK \n");
+
+        /* compression parameters instead of levels */
+        DISPLAYLEVEL(3, "LZ4_compress_HC_extStateHC_advanced() with level parameters : ");
+        {   int const srcSize = 128 KB;
+            int const cCapacity = LZ4_compressBound(srcSize);
+            char* const cRef = (char*)malloc((size_t)cCapacity);
+            int cLevel;
+            assert(cRef != NULL);
+            assert(cCapacity <= (int)testCompressedSize);
+            for (cLevel = 1; cLevel <= LZ4HC_CLEVEL_MAX; cLevel++) {
+                LZ4HC_cParams_t const cParams = LZ4_getCompressionParametersHC(cLevel);
+                int const refSize = LZ4_compress_HC_extStateHC(&sHC, testInput, cRef, srcSize, cCapacity, cLevel);
+                int const cSize = LZ4_compress_HC_extStateHC_advanced(&sHC, testInput, testCompressed, srcSize, cCapacity, &cParams);
+                FUZ_CHECKTEST(refSize == 0, "LZ4_compress_HC_extStateHC() failed at level %i", cLevel);
+                FUZ_CHECKTEST(cSize != refSize, "level %i : compressed size differs (%i != %i)", cLevel, cSize, refSize);
+                FUZ_CHECKTEST(memcmp(testCompressed, cRef, (size_t)refSize), "level %i : compressed content differs", cLevel);
+            }
+            /* custom table sizes are preserved : the state buffer is only large enough for them */
+            {   int const stateSize = LZ4_sizeofStateHC_advanced(12, 12);
+                void* const buffer = malloc((size_t)stateSize);
+                LZ4_streamHC_t* const state = LZ4_initStreamHC_advanced(buffer, (size_t)stateSize, 12, 12);
+                FUZ_CHECKTEST(state == NULL, "LZ4_initStreamHC_advanced(12, 12) failed");
+                for (cLevel = 1; cLevel <= LZ4HC_CLEVEL_MAX; cLevel++) {
+                    LZ4HC_cParams_t const cParams = LZ4_getCompressionParametersHC(cLevel);
+                    int const refSize = LZ4_compress_HC_extStateHC_fastReset(state, testInput, cRef, srcSize, cCapacity, cLevel);
+                    int const cSize = LZ4_compress_HC_extStateHC_advanced(state, testInput, testCompressed, srcSize, cCapacity, &cParams);
+                    FUZ_CHECKTEST(refSize == 0, "(12, 12) : LZ4_compress_HC_extStateHC_fastReset() failed at level %i", cLevel);
+                    FUZ_CHECKTEST(cSize != refSize, "(12, 12) level %i : compressed size differs (%i != %i)", cLevel, cSize, refSize);
+                    FUZ_CHECKTEST(memcmp(testCompressed, cRef, (size_t)refSize), "(12, 12) level %i : compressed content differs", cLevel);
+                }
+                free(buffer);
+            }
+            free(cRef);
+        }
+        DISPLAYLEVEL(3, "OK \n");
+
+        DISPLAYLEVEL(3, "LZ4_compress_HC_continue_advanced() with custom parameters : ");
+        {   static const LZ4HC_cParams_t cParamsTable[] = {
+                { LZ4HC_strat_hc, 512, 16 },
+                { LZ4HC_strat_opt, 48, 32 },
+                { LZ4HC_strat_hc, 1, 0 },
+                { LZ4HC_strat_opt, 256, 100000 },   /* targetLength is clamped */
+                { LZ4HC_strat_btopt, 64, 64 },
+                { LZ4HC_strat_mid, 0, 0 },
+            };
+            int const nbParams = (int)(sizeof(cParamsTable) / sizeof(cParamsTable[0]));
+            int const dictSize = 32 KB;
+            int const blockSize = 24 KB;
+            int const cCapacity = LZ4_compressBound(blockSize);
+            int n;
+            assert((size_t)(dictSize + nbParams * blockSize) <= testInputSize);
+            assert(cCapacity <= (int)testCompressedSize);
+            {   LZ4HC_cParams_t invalid = cParamsTable[0];
+                invalid.strategy = (LZ4HC_strategy_e)(LZ4HC_strat_btopt + 1);
+                FUZ_CHECKTEST(LZ4_compress_HC_extStateHC_advanced(&sHC, testInput, testCompressed, blockSize, cCapacity, &invalid) != 0,
+                            "invalid strategy must be detected");
+                FUZ_CHECKTEST(LZ4_compress_HC_extStateHC_advanced(&sHC, testInput, testCompressed, blockSize, cCapacity, NULL) != 0,
+                            "NULL parameters must be detected");
+            }
+            /* parameters change from one block to the next */
+            LZ4_resetStreamHC_fast(&sHC, LZ4HC_CLEVEL_DEFAULT);
+            LZ4_loadDictHC(&sHC, testInput, dictSize);
+            for (n = 0; n < nbParams; n++) {
+                const char* const src = testInput + dictSize + n * blockSize;
+                int const cSize = LZ4_compress_HC_continue_advanced(&sHC, src, testCompressed, blockSize, cCapacity, &cParamsTable[n]);
+                FUZ_CHECKTEST(cSize == 0, "parameters %i : compression failed", n);
+                {   int const dSize = LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, blockSize, testInput, (int)(src - testInput));
+                    FUZ_CHECKTEST(dSize != blockSize, "parameters %i : decompression failed", n);
+                    FUZ_CHECKTEST(memcmp(testVerify, src, (size_t)blockSize), "parameters %i : corruption", n);
+            }   }
+            /* one-shot, and with an attached dictionary */
+            for (n = 0; n < nbParams; n++) {
+                int const cSize = LZ4_compress_HC_extStateHC_advanced(&sHC, testInput, testCompressed, blockSize, cCapacity, &cParamsTable[n]);
+                FUZ_CHECKTEST(cSize == 0, "parameters %i : one-shot compression failed", n);
+                FUZ_CHECKTEST(LZ4_decompress_safe(testCompressed, testVerify, cSize, blockSize) != blockSize, "parameters %i : decompression failed", n);
+                FUZ_CHECKTEST(memcmp(testVerify, testInput, (size_t)blockSize), "parameters %i : corruption", n);
+            }
+            {   LZ4_streamHC_t* const dictState = LZ4_createStreamHC();
+                assert(dictState != NULL);
+                for (n = 0; n < nbParams; n++) {
+                    int cSize;
+                    LZ4_resetStreamHC_fast(dictState, (cParamsTable[n].strategy == LZ4HC_strat_mid) ? LZ4HC_CLEVEL_MIN : LZ4HC_CLEVEL_DEFAULT);
+                    LZ4_loadDictHC(dictState, testInput, dictSize);
+                    LZ4_resetStreamHC_fast(&sHC, LZ4HC_CLEVEL_DEFAULT);
+                    LZ4_attach_HC_dictionary(&sHC, dictState);
+                    cSize = LZ4_compress_HC_continue_advanced(&sHC, testInput + dictSize, testCompressed, blockSize, cCapacity, &cParamsTable[n]);
+                    FUZ_CHECKTEST(cSize == 0, "parameters %i : compression with attached dictionary failed", n);
+                    FUZ_CHECKTEST(LZ4_decompress_safe_usingDict(testCompressed, testVerify, cSize, blockSize, testInput, dictSize) != blockSize,
+                                "parameters %i : decompression with dictionary failed", n);
+                    FUZ_CHECKTEST(memcmp(testVerify, testInput + dictSize, (size_t)blockSize), "parameters %i : corruption with attached dictionary", n);
+                }
+                LZ4_attach_HC_dictionary(&sHC, NULL);
+                LZ4_freeStreamHC(dictState);
+            }
+        }
+        DISPLAYLEVEL(3, "OK \n");
+
         /* simple dictionary HC compression test */
         DISPLAYLEVEL(3, "HC dictionary compression test : ");
         {   U64 const crc64 = XXH64(testInput + 64 KB, testCompressedSize, 0);
@@ -71,6 +71,9 @@ test "$(datagen -g20KB | lz4 -c -1 | wc -c)" -lt "$(datagen -g20KB| lz4 -c --fas
 test "$(datagen -g20KB | lz4 -c --fast=1 | wc -c)" -eq "$(datagen -g20KB| lz4 -c --fast| wc -c)" # checks default fast compression is -1
 lz4 -c --fast=0 $FPREFIX-dg20K && exit 1  # lz4 should fail when fast=0
 lz4 -c --fast=-1 $FPREFIX-dg20K && exit 1 # lz4 should fail when fast=-1
+# Benchmark autotune
+lz4 -i0 -B5 --autotune=c100 $FPREFIX-dg20k | grep -E "Recommended|No setting"
+lz4 -i0 --autotune=x5 $FPREFIX-dg20k && exit 1  # lz4 should fail on unknown target
 # Multithreading commands
 datagen -g16M | lz4 -T2 | lz4 -t
 datagen -g16M | lz4 --threads=2 | lz4 -t